@@ -0,0 +1,339 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "VppAclCompiler.hpp"
+
+namespace VPP
+{
+typedef std::vector<uint8_t> bytes_t;
+
+static bytes_t
+to_bytes(const boost::asio::ip::address &addr)
+{
+    if (addr.is_v4())
+    {
+        auto b = addr.to_v4().to_bytes();
+        return bytes_t(b.begin(), b.end());
+    }
+    auto b = addr.to_v6().to_bytes();
+    return bytes_t(b.begin(), b.end());
+}
+
+/**
+ * Are the first len bits of the two addresses equal
+ */
+static bool
+bits_equal(const bytes_t &a, const bytes_t &b, uint8_t len)
+{
+    for (uint8_t i = 0; i < len / 8; i++)
+        if (a[i] != b[i]) return false;
+
+    if (len % 8)
+    {
+        uint8_t mask = 0xff << (8 - len % 8);
+
+        return (0 == ((a[len / 8] ^ b[len / 8]) & mask));
+    }
+    return true;
+}
+
+static bool
+same_family(const route::prefix_t &a, const route::prefix_t &b)
+{
+    return (a.address().is_v4() == b.address().is_v4());
+}
+
+static bool
+same_prefix(const route::prefix_t &a, const route::prefix_t &b)
+{
+    return (AclCompiler::contains(a, b) && AclCompiler::contains(b, a));
+}
+
+/**
+ * The prefix that matches exactly the addresses of both, if there is one
+ */
+static boost::optional<route::prefix_t>
+prefix_union(const route::prefix_t &a, const route::prefix_t &b)
+{
+    if (AclCompiler::contains(a, b)) return a;
+    if (AclCompiler::contains(b, a)) return b;
+
+    uint8_t len = a.mask_width();
+
+    if (!same_family(a, b) || 0 == len || len != b.mask_width())
+        return boost::none;
+
+    bytes_t ab = to_bytes(a.address());
+
+    if (!bits_equal(ab, to_bytes(b.address()), len - 1)) return boost::none;
+
+    /*
+     * siblings; the parent is the first address with the host bits
+     * cleared.
+     */
+    len -= 1;
+    for (size_t i = 0; i < ab.size(); i++)
+    {
+        if (i * 8 >= len)
+            ab[i] = 0;
+        else if ((i + 1) * 8 > len)
+            ab[i] &= (0xff << (8 - len % 8));
+    }
+
+    if (a.address().is_v4())
+    {
+        boost::asio::ip::address_v4::bytes_type b4;
+        std::copy(ab.begin(), ab.end(), b4.begin());
+        return route::prefix_t(boost::asio::ip::address_v4(b4), len);
+    }
+
+    boost::asio::ip::address_v6::bytes_type b6;
+    std::copy(ab.begin(), ab.end(), b6.begin());
+    return route::prefix_t(boost::asio::ip::address_v6(b6), len);
+}
+
+static bool
+range_contains(uint16_t a_first,
+               uint16_t a_last,
+               uint16_t b_first,
+               uint16_t b_last)
+{
+    return (a_first <= b_first && b_last <= a_last);
+}
+
+static bool
+range_overlaps(uint16_t a_first,
+               uint16_t a_last,
+               uint16_t b_first,
+               uint16_t b_last)
+{
+    return (a_first <= b_last && b_first <= a_last);
+}
+
+/**
+ * Do the ranges overlap or abut, so their union is a range
+ */
+static bool
+range_joins(uint16_t a_first,
+            uint16_t a_last,
+            uint16_t b_first,
+            uint16_t b_last)
+{
+    return ((uint32_t)a_first <= (uint32_t)b_last + 1 &&
+            (uint32_t)b_first <= (uint32_t)a_last + 1);
+}
+
+bool
+AclCompiler::contains(const route::prefix_t &a, const route::prefix_t &b)
+{
+    if (!same_family(a, b) || a.mask_width() > b.mask_width()) return false;
+
+    return bits_equal(
+        to_bytes(a.address()), to_bytes(b.address()), a.mask_width());
+}
+
+bool
+AclCompiler::covers(const ACL::l3_rule &a, const ACL::l3_rule &b)
+{
+    if (!same_family(a.src(), b.src()) || a.proto() != b.proto())
+        return false;
+
+    if (!contains(a.src(), b.src()) || !contains(a.dst(), b.dst()))
+        return false;
+
+    if (!range_contains(a.srcport_or_icmptype_first(),
+                        a.srcport_or_icmptype_last(),
+                        b.srcport_or_icmptype_first(),
+                        b.srcport_or_icmptype_last()) ||
+        !range_contains(a.dstport_or_icmpcode_first(),
+                        a.dstport_or_icmpcode_last(),
+                        b.dstport_or_icmpcode_first(),
+                        b.dstport_or_icmpcode_last()))
+        return false;
+
+    /*
+     * every flag 'a' tests must be tested, with the same value, by 'b'
+     */
+    return (0 == (a.tcp_flags_mask() & ~b.tcp_flags_mask()) &&
+            0 == ((a.tcp_flags_value() ^ b.tcp_flags_value()) &
+                  a.tcp_flags_mask()));
+}
+
+bool
+AclCompiler::intersects(const ACL::l3_rule &a, const ACL::l3_rule &b)
+{
+    if (!same_family(a.src(), b.src())) return false;
+
+    if (!(contains(a.src(), b.src()) || contains(b.src(), a.src())) ||
+        !(contains(a.dst(), b.dst()) || contains(b.dst(), a.dst())))
+        return false;
+
+    /*
+     * a rule for any protocol may match anything the other does
+     */
+    if (0 == a.proto() || 0 == b.proto()) return true;
+
+    if (a.proto() != b.proto()) return false;
+
+    return (range_overlaps(a.srcport_or_icmptype_first(),
+                           a.srcport_or_icmptype_last(),
+                           b.srcport_or_icmptype_first(),
+                           b.srcport_or_icmptype_last()) &&
+            range_overlaps(a.dstport_or_icmpcode_first(),
+                           a.dstport_or_icmpcode_last(),
+                           b.dstport_or_icmpcode_first(),
+                           b.dstport_or_icmpcode_last()) &&
+            0 == ((a.tcp_flags_value() ^ b.tcp_flags_value()) &
+                  a.tcp_flags_mask() & b.tcp_flags_mask()));
+}
+
+/**
+ * The rule, at a's priority, that matches exactly the packets of both,
+ * if there is one. That is when they differ in only one dimension.
+ */
+static boost::optional<ACL::l3_rule>
+merge(const ACL::l3_rule &a, const ACL::l3_rule &b)
+{
+    if (!(a.action() == b.action()) || !same_family(a.src(), b.src()) ||
+        a.proto() != b.proto() || a.tcp_flags_mask() != b.tcp_flags_mask() ||
+        a.tcp_flags_value() != b.tcp_flags_value())
+        return boost::none;
+
+    route::prefix_t src = a.src(), dst = a.dst();
+    uint16_t sp_first = a.srcport_or_icmptype_first();
+    uint16_t sp_last = a.srcport_or_icmptype_last();
+    uint16_t dp_first = a.dstport_or_icmpcode_first();
+    uint16_t dp_last = a.dstport_or_icmpcode_last();
+
+    bool src_eq = same_prefix(a.src(), b.src());
+    bool dst_eq = same_prefix(a.dst(), b.dst());
+    bool sp_eq = (sp_first == b.srcport_or_icmptype_first() &&
+                  sp_last == b.srcport_or_icmptype_last());
+    bool dp_eq = (dp_first == b.dstport_or_icmpcode_first() &&
+                  dp_last == b.dstport_or_icmpcode_last());
+
+    if (!src_eq + !dst_eq + !sp_eq + !dp_eq != 1) return boost::none;
+
+    if (!src_eq)
+    {
+        boost::optional<route::prefix_t> u = prefix_union(a.src(), b.src());
+        if (!u) return boost::none;
+        src = u.get();
+    }
+    else if (!dst_eq)
+    {
+        boost::optional<route::prefix_t> u = prefix_union(a.dst(), b.dst());
+        if (!u) return boost::none;
+        dst = u.get();
+    }
+    else if (!sp_eq)
+    {
+        if (!range_joins(sp_first,
+                         sp_last,
+                         b.srcport_or_icmptype_first(),
+                         b.srcport_or_icmptype_last()))
+            return boost::none;
+        sp_first = std::min(sp_first, b.srcport_or_icmptype_first());
+        sp_last = std::max(sp_last, b.srcport_or_icmptype_last());
+    }
+    else
+    {
+        if (!range_joins(dp_first,
+                         dp_last,
+                         b.dstport_or_icmpcode_first(),
+                         b.dstport_or_icmpcode_last()))
+            return boost::none;
+        dp_first = std::min(dp_first, b.dstport_or_icmpcode_first());
+        dp_last = std::max(dp_last, b.dstport_or_icmpcode_last());
+    }
+
+    return ACL::l3_rule(a.priority(),
+                        a.action(),
+                        src,
+                        dst,
+                        a.proto(),
+                        sp_first,
+                        sp_last,
+                        dp_first,
+                        dp_last,
+                        a.tcp_flags_mask(),
+                        a.tcp_flags_value());
+}
+
+ACL::l3_list::rules_t
+AclCompiler::compile(const ACL::l3_list::rules_t &rules)
+{
+    /*
+     * the rules in the order they are evaluated
+     */
+    std::vector<ACL::l3_rule> v(rules.begin(), rules.end());
+    bool changed = true;
+
+    while (changed)
+    {
+        changed = false;
+
+        for (size_t i = 1; i < v.size();)
+        {
+            bool shadowed = false;
+
+            for (size_t j = 0; j < i && !shadowed; j++)
+                shadowed = covers(v[j], v[i]);
+
+            if (shadowed)
+            {
+                v.erase(v.begin() + i);
+                changed = true;
+            }
+            else
+                i++;
+        }
+
+        for (size_t i = 0; i < v.size(); i++)
+        {
+            for (size_t j = i + 1; j < v.size();)
+            {
+                boost::optional<ACL::l3_rule> m = merge(v[i], v[j]);
+
+                /*
+                 * merging moves rule j up to i, which is only safe if
+                 * none of the rules it then jumps would have given its
+                 * packets a different action.
+                 */
+                for (size_t k = i + 1; m && k < j; k++)
+                    if (!(v[k].action() == v[j].action()) &&
+                        intersects(v[k], v[j]))
+                        m = boost::none;
+
+                if (m)
+                {
+                    v[i] = m.get();
+                    v.erase(v.begin() + j);
+                    changed = true;
+                }
+                else
+                    j++;
+            }
+        }
+    }
+
+    return ACL::l3_list::rules_t(v.begin(), v.end());
+}
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
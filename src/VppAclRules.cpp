@@ -0,0 +1,207 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <tuple>
+
+#include "VppAclRules.hpp"
+#include "VppAclCompiler.hpp"
+
+namespace VPP
+{
+bool
+AclRules::rule_less::operator()(const VOM::ACL::l3_rule &a,
+                                const VOM::ACL::l3_rule &b) const
+{
+    return (std::make_tuple(a.priority(),
+                            a.action().value(),
+                            a.src(),
+                            a.dst(),
+                            a.proto(),
+                            a.srcport_or_icmptype_first(),
+                            a.srcport_or_icmptype_last(),
+                            a.dstport_or_icmpcode_first(),
+                            a.dstport_or_icmpcode_last(),
+                            a.tcp_flags_mask(),
+                            a.tcp_flags_value()) <
+            std::make_tuple(b.priority(),
+                            b.action().value(),
+                            b.src(),
+                            b.dst(),
+                            b.proto(),
+                            b.srcport_or_icmptype_first(),
+                            b.srcport_or_icmptype_last(),
+                            b.dstport_or_icmpcode_first(),
+                            b.dstport_or_icmpcode_last(),
+                            b.tcp_flags_mask(),
+                            b.tcp_flags_value()));
+}
+
+AclRules &
+AclRules::get()
+{
+    /*
+     * never destroyed, as inspect may hold it until exit
+     */
+    static AclRules *instance = []() {
+        AclRules *r = new AclRules();
+
+        VOM::inspect::register_handler(
+            {"acl-rules"}, "ACL rules and their origins", r);
+        return r;
+    }();
+
+    return *instance;
+}
+
+void
+AclRules::add(const std::string &owner,
+              const std::string &acl,
+              const VOM::ACL::l3_list::rules_t &rules,
+              const origins_t &origins)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    m_owners[owner].insert(acl);
+
+    /*
+     * ACLs are named for their rules, so one of this name has the same
+     * rules, but an owner's rules may have been built from others
+     */
+    auto it = m_acls.find(acl);
+
+    if (it == m_acls.end())
+    {
+        it = m_acls.emplace(acl, acl_t()).first;
+
+        for (auto &rule : rules)
+            it->second.rules.push_back({rule.to_string(), {}});
+    }
+
+    acl_t &a = it->second;
+
+    a.owners.insert(owner);
+    a.shadowed.erase(owner);
+    for (auto &r : a.rules)
+        r.uris.erase(owner);
+
+    for (auto &o : origins)
+    {
+        uint32_t index = 0;
+
+        for (auto &rule : rules)
+        {
+            if (AclCompiler::covers(rule, o.first))
+            {
+                if (rule.action() == o.first.action())
+                    a.rules[index].uris[owner].insert(o.second.begin(),
+                                                      o.second.end());
+                else
+                    a.shadowed[owner].insert(o.second.begin(),
+                                             o.second.end());
+                break;
+            }
+            index++;
+        }
+    }
+}
+
+void
+AclRules::remove(const std::string &owner)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    auto it = m_owners.find(owner);
+
+    if (it == m_owners.end()) return;
+
+    for (auto &acl : it->second)
+    {
+        auto a = m_acls.find(acl);
+
+        if (a == m_acls.end()) continue;
+
+        a->second.owners.erase(owner);
+        if (a->second.owners.empty())
+        {
+            m_acls.erase(a);
+            continue;
+        }
+
+        a->second.shadowed.erase(owner);
+        for (auto &r : a->second.rules)
+            r.uris.erase(owner);
+    }
+    m_owners.erase(it);
+}
+
+std::set<std::string>
+AclRules::merge(const std::map<std::string, std::set<std::string>> &uris)
+{
+    std::set<std::string> all;
+
+    for (auto &u : uris)
+        all.insert(u.second.begin(), u.second.end());
+
+    return all;
+}
+
+std::set<std::string>
+AclRules::uris(const std::string &acl, uint32_t index) const
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    auto it = m_acls.find(acl);
+
+    if (it == m_acls.end() || index >= it->second.rules.size()) return {};
+
+    return merge(it->second.rules[index].uris);
+}
+
+std::set<std::string>
+AclRules::shadowed(const std::string &acl) const
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    auto it = m_acls.find(acl);
+
+    if (it == m_acls.end()) return {};
+
+    return merge(it->second.shadowed);
+}
+
+void
+AclRules::show(std::ostream &os)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    for (auto &a : m_acls)
+    {
+        os << a.first << " owners:" << a.second.owners.size() << std::endl;
+
+        uint32_t index = 0;
+
+        for (auto &r : a.second.rules)
+        {
+            os << "  [" << index++ << "] " << r.desc << std::endl;
+
+            for (auto &uri : merge(r.uris))
+                os << "      " << uri << std::endl;
+        }
+        for (auto &uri : merge(a.second.shadowed))
+            os << "  shadowed " << uri << std::endl;
+    }
+}
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
@@ -7,6 +7,8 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <algorithm>
+
 #include <opflexagent/PolicyManager.h>
 
 #include <modelgbp/gbp/HashingAlgorithmEnumT.hpp>
@@ -86,43 +88,13 @@ getBdId(IdGen &id_gen, const std::shared_ptr<modelgbp::gbp::BridgeDomain> epgBd)
 }
 
 void
-ContractManager::handle_update(const opflex::modb::URI &uri)
+ContractManager::build_rules(const opflex::modb::URI &uri, contract_t &c)
 {
-    VLOGD << "Updating contract " << uri;
-
-    const std::string &uuid = uri.toString();
-
-    OM::mark_n_sweep ms(uuid);
-
     opflexagent::PolicyManager &polMgr = m_agent.getPolicyManager();
-    if (!polMgr.contractExists(uri))
-    {
-        // Contract removed
-        return;
-    }
 
-    opflexagent::PolicyManager::uri_set_t provURIs;
-    opflexagent::PolicyManager::uri_set_t consURIs;
-    opflexagent::PolicyManager::uri_set_t intraURIs;
-    polMgr.getContractProviders(uri, provURIs);
-    polMgr.getContractConsumers(uri, consURIs);
-    polMgr.getContractIntra(uri, intraURIs);
-
-    typedef std::unordered_set<uint32_t> id_set_t;
-    id_set_t provIds;
-    id_set_t consIds;
-
-    get_group_sclass(m_agent, provURIs, provIds);
-    get_group_sclass(m_agent, consURIs, consIds);
-
-    opflexagent::PolicyManager::rule_list_t rules;
-    polMgr.getContractRules(uri, rules);
+    c.has_redirect = false;
 
-    gbp_contract::gbp_rules_t gbp_rules;
-    ACL::l3_list::rules_t in_rules, out_rules;
-    gbp_contract::ethertype_set_t in_ethertypes, out_ethertypes;
-
-    for (auto rule : rules)
+    for (auto rule : c.rules)
     {
         uint8_t dir = rule->getDirection();
         const std::shared_ptr<modelgbp::gbpe::L24Classifier> &cls =
@@ -138,14 +110,16 @@ ContractManager::handle_update(const opflex::modb::URI &uri)
         if (dir == modelgbp::gbp::DirectionEnumT::CONST_BIDIRECTIONAL ||
             dir == modelgbp::gbp::DirectionEnumT::CONST_IN)
         {
-            auto it = out_ethertypes.find(etherType);
-            if (it == out_ethertypes.end()) out_ethertypes.insert(etherType);
+            auto it = c.out_ethertypes.find(etherType);
+            if (it == c.out_ethertypes.end())
+                c.out_ethertypes.insert(etherType);
         }
         if (dir == modelgbp::gbp::DirectionEnumT::CONST_BIDIRECTIONAL ||
             dir == modelgbp::gbp::DirectionEnumT::CONST_OUT)
         {
-            auto it = in_ethertypes.find(etherType);
-            if (it == in_ethertypes.end()) in_ethertypes.insert(etherType);
+            auto it = c.in_ethertypes.find(etherType);
+            if (it == c.in_ethertypes.end())
+                c.in_ethertypes.insert(etherType);
         }
 
         if (etherType != modelgbp::l2::EtherTypeEnumT::CONST_IPV4 &&
@@ -171,14 +145,18 @@ ContractManager::handle_update(const opflex::modb::URI &uri)
         if (dir == modelgbp::gbp::DirectionEnumT::CONST_BIDIRECTIONAL ||
             dir == modelgbp::gbp::DirectionEnumT::CONST_IN)
         {
-            out_rules.insert(l3_rule);
+            c.out_rules.insert(l3_rule);
+            c.out_origins[l3_rule].insert(rule->getURI().toString());
         }
         if (dir == modelgbp::gbp::DirectionEnumT::CONST_BIDIRECTIONAL ||
             dir == modelgbp::gbp::DirectionEnumT::CONST_OUT)
         {
-            in_rules.insert(l3_rule);
+            c.in_rules.insert(l3_rule);
+            c.in_origins[l3_rule].insert(rule->getURI().toString());
         }
 
+        if (rule->getRedirect()) c.has_redirect = true;
+
         if (rule->getRedirect() && rule->getRedirectDestGrpURI())
         {
             opflexagent::PolicyManager::redir_dest_list_t redirList;
@@ -189,6 +167,12 @@ ContractManager::handle_update(const opflex::modb::URI &uri)
             polMgr.getPolicyDestGroup(
                 destGrpUri.get(), redirList, hashAlgo, resilientHashEnabled);
 
+            /*
+             * resilientHashEnabled is not rendered: gbp_rule's next-hop
+             * set takes only a hash mode and a set of next-hops, from
+             * which VPP builds its own buckets.
+             */
+
             for (auto dst : redirList)
             {
                 uint8_t macAddr[6] = {0};
@@ -203,6 +187,7 @@ ContractManager::handle_update(const opflex::modb::URI &uri)
             if (nhs.size() == 0)
             {
                 VLOGI << "Redirect Contract with no NHs: " << uri;
+                c.blackholes.insert(rule->getURI().toString());
                 continue;
             }
 
@@ -214,7 +199,7 @@ ContractManager::handle_update(const opflex::modb::URI &uri)
                 gbp_rule gr(rule->getPriority(),
                             next_hop_set,
                             gbp_rule::action_t::REDIRECT);
-                gbp_rules.insert(gr);
+                c.gbp_rules.insert(gr);
             }
             else if (hashAlgo ==
                      modelgbp::gbp::HashingAlgorithmEnumT::CONST_DSTIP)
@@ -224,7 +209,7 @@ ContractManager::handle_update(const opflex::modb::URI &uri)
                 gbp_rule gr(rule->getPriority(),
                             next_hop_set,
                             gbp_rule::action_t::REDIRECT);
-                gbp_rules.insert(gr);
+                c.gbp_rules.insert(gr);
             }
             else if (hashAlgo ==
                      modelgbp::gbp::HashingAlgorithmEnumT::CONST_SRCIP)
@@ -234,50 +219,218 @@ ContractManager::handle_update(const opflex::modb::URI &uri)
                 gbp_rule gr(rule->getPriority(),
                             next_hop_set,
                             gbp_rule::action_t::REDIRECT);
-                gbp_rules.insert(gr);
+                c.gbp_rules.insert(gr);
             }
         }
         else if (rule->getAllow())
         {
             gbp_rule gr(rule->getPriority(), gbp_rule::action_t::PERMIT);
-            gbp_rules.insert(gr);
+            c.gbp_rules.insert(gr);
         }
         else
         {
             gbp_rule gr(rule->getPriority(), gbp_rule::action_t::DENY);
-            gbp_rules.insert(gr);
+            c.gbp_rules.insert(gr);
         }
     }
+}
 
-    for (const uint32_t &pvnid : provIds)
+static std::string
+pair_key(const std::string &uuid, const ContractPairs::sclass_pair_t &pair)
+{
+    return (uuid + ":" + std::to_string(pair.first) + ":" +
+            std::to_string(pair.second));
+}
+
+void
+ContractManager::write_pair(const std::string &uuid,
+                            const contract_t &c,
+                            const ContractPairs::sclass_pair_t &pair)
+{
+    const std::string key = pair_key(uuid, pair);
+    OM::mark_n_sweep ms(key);
+
+    VLOGD << "Contract prov:" << pair.first << " cons:" << pair.second;
+
+    if (!c.in_rules.empty())
+    {
+        ACL::l3_list inAcl(uuid + "in", c.in_rules);
+        gbp_contract gbpc_in(
+            pair.first, pair.second, inAcl, c.gbp_rules, c.in_ethertypes);
+        OM::write(key, gbpc_in);
+    }
+    if (!c.out_rules.empty())
+    {
+        ACL::l3_list outAcl(uuid + "out", c.out_rules);
+        gbp_contract gbpc_out(
+            pair.second, pair.first, outAcl, c.gbp_rules, c.out_ethertypes);
+        OM::write(key, gbpc_out);
+    }
+}
+
+/**
+ * The pairs, source to destination, for which a contract's ACLs are
+ * rendered
+ */
+static std::set<ContractPairs::sclass_pair_t>
+acl_pairs(const std::set<ContractPairs::sclass_pair_t> &pairs,
+          bool in,
+          bool out)
+{
+    std::set<ContractPairs::sclass_pair_t> sp;
+
+    for (auto &pair : pairs)
+    {
+        if (in) sp.insert(pair);
+        if (out) sp.insert({pair.second, pair.first});
+    }
+
+    return sp;
+}
+
+static bool
+rules_equal(const opflexagent::PolicyManager::rule_list_t &a,
+            const opflexagent::PolicyManager::rule_list_t &b)
+{
+    return (a.size() == b.size() &&
+            std::equal(a.begin(),
+                       a.end(),
+                       b.begin(),
+                       [](const std::shared_ptr<opflexagent::PolicyRule> &x,
+                          const std::shared_ptr<opflexagent::PolicyRule> &y) {
+                           return (*x == *y);
+                       }));
+}
+
+void
+ContractManager::remove(const std::string &uuid)
+{
+    auto it = m_contracts.find(uuid);
+
+    if (it == m_contracts.end()) return;
+
+    for (auto &pair : it->second.pairs)
+        OM::remove(pair_key(uuid, pair));
+    OM::remove(uuid);
+
+    AclRules::get().remove(uuid);
+    ContractPairs::get().remove(uuid);
+    m_contracts.erase(it);
+}
+
+void
+ContractManager::handle_update(const opflex::modb::URI &uri)
+{
+    VLOGD << "Updating contract " << uri;
+
+    const std::string &uuid = uri.toString();
+
+    opflexagent::PolicyManager &polMgr = m_agent.getPolicyManager();
+    if (!polMgr.contractExists(uri))
     {
+        // Contract removed
+        remove(uuid);
+        return;
+    }
+
+    opflexagent::PolicyManager::uri_set_t provURIs;
+    opflexagent::PolicyManager::uri_set_t consURIs;
+    polMgr.getContractProviders(uri, provURIs);
+    polMgr.getContractConsumers(uri, consURIs);
+
+    typedef std::unordered_set<uint32_t> id_set_t;
+    id_set_t provIds;
+    id_set_t consIds;
+
+    get_group_sclass(m_agent, provURIs, provIds);
+    get_group_sclass(m_agent, consURIs, consIds);
+
+    std::set<ContractPairs::sclass_pair_t> pairs;
+
+    for (const uint32_t &pvnid : provIds)
         for (const uint32_t &cvnid : consIds)
-        {
-            if (pvnid == cvnid) /* intra group is allowed by default */
-                continue;
+            if (pvnid != cvnid) /* intra group is allowed by default */
+                pairs.insert({pvnid, cvnid});
 
-            VLOGD << "Contract prov:" << pvnid << " cons:" << cvnid;
+    opflexagent::PolicyManager::rule_list_t rules;
+    polMgr.getContractRules(uri, rules);
 
-            if (!in_rules.empty())
-            {
-                ACL::l3_list inAcl(uuid + "in", in_rules);
-                OM::write(uuid, inAcl);
+    /*
+     * The rules are compiled, and the pairs rendered, incrementally; a
+     * change to the providers or consumers renders only the pairs added
+     * and removes only those gone. The next-hops of redirect rules come
+     * from their destination groups, not the rules, so a contract that
+     * redirects is always rebuilt.
+     */
+    auto it = m_contracts.find(uuid);
+    std::set<ContractPairs::sclass_pair_t> old_pairs, old_acl_pairs;
+    bool rebuild = true;
+
+    if (it != m_contracts.end())
+    {
+        old_pairs = it->second.pairs;
+        old_acl_pairs = acl_pairs(old_pairs,
+                                  !it->second.in_rules.empty(),
+                                  !it->second.out_rules.empty());
+        rebuild = (it->second.has_redirect ||
+                   !rules_equal(it->second.rules, rules));
+    }
 
-                gbp_contract gbpc_in(
-                    pvnid, cvnid, inAcl, gbp_rules, in_ethertypes);
-                OM::write(uuid, gbpc_in);
-            }
-            if (!out_rules.empty())
-            {
-                ACL::l3_list outAcl(uuid + "out", out_rules);
-                OM::write(uuid, outAcl);
+    if (rebuild)
+    {
+        contract_t c;
 
-                gbp_contract gbpc_out(
-                    cvnid, pvnid, outAcl, gbp_rules, out_ethertypes);
-                OM::write(uuid, gbpc_out);
-            }
+        c.rules = rules;
+        build_rules(uri, c);
+
+        OM::mark_n_sweep ms(uuid);
+        AclRules::get().remove(uuid);
+
+        if (!c.in_rules.empty())
+        {
+            ACL::l3_list inAcl(uuid + "in", c.in_rules);
+            OM::write(uuid, inAcl);
+            AclRules::get().add(uuid, inAcl.key(), c.in_rules, c.in_origins);
         }
+        if (!c.out_rules.empty())
+        {
+            ACL::l3_list outAcl(uuid + "out", c.out_rules);
+            OM::write(uuid, outAcl);
+            AclRules::get().add(
+                uuid, outAcl.key(), c.out_rules, c.out_origins);
+        }
+
+        m_contracts[uuid] = std::move(c);
+        it = m_contracts.find(uuid);
     }
+
+    contract_t &c = it->second;
+
+    for (auto &pair : old_pairs)
+        if (!pairs.count(pair)) OM::remove(pair_key(uuid, pair));
+
+    for (auto &pair : pairs)
+        if (rebuild || !old_pairs.count(pair)) write_pair(uuid, c, pair);
+
+    VLOGD << "Contract " << uri << (rebuild ? " rebuilt" : " updated")
+          << " pairs:" << pairs.size() << " was:" << old_pairs.size();
+
+    c.pairs = std::move(pairs);
+
+    /*
+     * likewise the pairs reported; the blackholes change only on a
+     * rebuild
+     */
+    std::set<ContractPairs::sclass_pair_t> acl_pairs_now =
+        acl_pairs(c.pairs, !c.in_rules.empty(), !c.out_rules.empty());
+
+    for (auto &pair : old_acl_pairs)
+        if (!acl_pairs_now.count(pair))
+            ContractPairs::get().remove(uuid, pair);
+
+    for (auto &pair : acl_pairs_now)
+        if (rebuild || !old_acl_pairs.count(pair))
+            ContractPairs::get().add(uuid, pair, c.blackholes);
 }
 
 }; // namespace VPP
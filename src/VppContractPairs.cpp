@@ -0,0 +1,124 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "VppContractPairs.hpp"
+
+namespace VPP
+{
+ContractPairs &
+ContractPairs::get()
+{
+    /*
+     * never destroyed, as inspect may hold it until exit
+     */
+    static ContractPairs *instance = []() {
+        ContractPairs *s = new ContractPairs();
+
+        VOM::inspect::register_handler(
+            {"contract-pairs"}, "Contracts' sclass pairs and blackholes", s);
+        return s;
+    }();
+
+    return *instance;
+}
+
+void
+ContractPairs::add(const std::string &contract,
+                   const sclass_pair_t &pair,
+                   const std::set<std::string> &blackholes)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    m_contracts[contract].insert(pair);
+    m_pairs[pair][contract] = blackholes;
+}
+
+void
+ContractPairs::remove(const std::string &contract)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    auto it = m_contracts.find(contract);
+
+    if (it == m_contracts.end()) return;
+
+    for (auto &pair : it->second)
+    {
+        auto p = m_pairs.find(pair);
+
+        if (p == m_pairs.end()) continue;
+
+        p->second.erase(contract);
+        if (p->second.empty()) m_pairs.erase(p);
+    }
+    m_contracts.erase(it);
+}
+
+void
+ContractPairs::remove(const std::string &contract, const sclass_pair_t &pair)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    auto it = m_contracts.find(contract);
+
+    if (it == m_contracts.end()) return;
+
+    it->second.erase(pair);
+    if (it->second.empty()) m_contracts.erase(it);
+
+    auto p = m_pairs.find(pair);
+
+    if (p == m_pairs.end()) return;
+
+    p->second.erase(contract);
+    if (p->second.empty()) m_pairs.erase(p);
+}
+
+std::set<std::string>
+ContractPairs::blackholes(const sclass_pair_t &pair) const
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+    std::set<std::string> uris;
+
+    auto it = m_pairs.find(pair);
+
+    if (it == m_pairs.end()) return uris;
+
+    for (auto &c : it->second)
+        uris.insert(c.second.begin(), c.second.end());
+
+    return uris;
+}
+
+void
+ContractPairs::show(std::ostream &os)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    for (auto &p : m_pairs)
+    {
+        os << "sclass " << p.first.first << " -> " << p.first.second
+           << std::endl;
+
+        for (auto &c : p.second)
+        {
+            os << "  " << c.first << std::endl;
+            for (auto &uri : c.second)
+                os << "    redirect without next-hops " << uri << std::endl;
+        }
+    }
+}
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
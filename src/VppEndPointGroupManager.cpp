@@ -26,8 +26,6 @@
 #include <vom/gbp_endpoint_group.hpp>
 #include <vom/gbp_subnet.hpp>
 #include <vom/gbp_vxlan.hpp>
-#include <vom/igmp_binding.hpp>
-#include <vom/igmp_listen.hpp>
 #include <vom/l2_binding.hpp>
 #include <vom/l3_binding.hpp>
 #include <vom/nat_binding.hpp>
@@ -45,6 +43,7 @@ namespace VPP
 {
 EndPointGroupManager::EndPointGroupManager(Runtime &runtime)
     : m_runtime(runtime)
+    , m_uplink_gen(runtime.uplink.generation())
 {
 }
 
@@ -165,40 +164,7 @@ EndPointGroupManager::mk_mcast_tunnel(Runtime &r,
                                       uint32_t vni,
                                       const std::string &maddr)
 {
-    /*
-     * Add the Vxlan mcast tunnel that will carry the broadcast
-     * and multicast traffic
-     */
-    boost::asio::ip::address dst = boost::asio::ip::address::from_string(maddr);
-
-    vxlan_tunnel vt(r.uplink.local_address(),
-                    dst,
-                    vni,
-                    *r.uplink.local_interface(),
-                    vxlan_tunnel::mode_t::GBP_L2);
-    OM::write(key, vt);
-
-    /*
-     * add the mcast group to accept via the uplink and
-     * forward locally.
-     */
-    route::path via_uplink(*r.uplink.local_interface(), nh_proto_t::IPV4);
-    route::ip_mroute mroute({dst.to_v4(), 32});
-
-    mroute.add(via_uplink, route::itf_flags_t::ACCEPT);
-    mroute.add({route::path::special_t::LOCAL}, route::itf_flags_t::FORWARD);
-    OM::write(key, mroute);
-
-    /*
-     * join the group on the uplink interface
-     */
-    igmp_binding igmp_b(*r.uplink.local_interface());
-    OM::write(key, igmp_b);
-
-    igmp_listen igmp_l(igmp_b, dst.to_v4());
-    OM::write(key, igmp_l);
-
-    return (vt.singular());
+    return (r.mcast.join(key, vni, maddr));
 }
 
 std::shared_ptr<VOM::interface>
@@ -240,6 +206,8 @@ EndPointGroupManager::mk_bvi(Runtime &r,
     bridge_domain_entry be(bd, bvi->l2_address().to_mac(), *bvi);
     OM::write(key, be);
 
+    r.stats.add(bvi->singular(), StatsTiers::class_t::BVI);
+
     return bvi;
 }
 
@@ -453,6 +421,7 @@ EndPointGroupManager::mk_group(Runtime &runtime,
              */
             std::shared_ptr<interface> encap_link =
                 runtime.uplink.mk_interface(key, fwd.vnid);
+            runtime.stats.add(encap_link, StatsTiers::class_t::UPLINK);
 
             /*
              * Add the encap-link to the BD
@@ -492,16 +461,60 @@ EndPointGroupManager::mk_group(Runtime &runtime,
     return gepg;
 }
 
+std::shared_ptr<VOM::gbp_endpoint_group>
+EndPointGroupManager::get_group(const opflex::modb::URI &epgURI)
+{
+    /*
+     * the spine proxy, and the tunnels' source, are from the uplink
+     */
+    if (m_uplink_gen != m_runtime.uplink.generation())
+    {
+        m_uplink_gen = m_runtime.uplink.generation();
+        m_groups.clear();
+    }
+
+    auto it = m_groups.find(epgURI);
+
+    if (it != m_groups.end()) return it->second.group;
+
+    /*
+     * Not yet rendered, or invalidated. Render the EPG, so the state
+     * built from its old forwarding info is swept.
+     */
+    handle_update(epgURI);
+
+    it = m_groups.find(epgURI);
+
+    if (it == m_groups.end()) return nullptr;
+
+    return it->second.group;
+}
+
+void
+EndPointGroupManager::invalidate_groups(const opflex::modb::URI &domURI)
+{
+    for (auto it = m_groups.begin(); it != m_groups.end();)
+    {
+        if (it->second.domains.count(domURI))
+            it = m_groups.erase(it);
+        else
+            ++it;
+    }
+}
+
 void
 EndPointGroupManager::handle_update(const opflex::modb::URI &epgURI)
 {
     const std::string &epg_uuid = epgURI.toString();
 
+    m_groups.erase(epgURI);
+
     /*
      * Mark all of this EPG's state stale. this RAII pattern
      * will sweep all state that is not updated.
      */
     OM::mark_n_sweep ms(epg_uuid);
+    MulticastGroups::sweep mcs(m_runtime.mcast, epg_uuid);
 
     VLOGD << "Updating endpoint-group:" << epgURI;
 
@@ -518,6 +531,21 @@ EndPointGroupManager::handle_update(const opflex::modb::URI &epgURI)
 
     if (gepg)
     {
+        group_t &group = m_groups[epgURI];
+
+        group.group = gepg;
+
+        boost::optional<std::shared_ptr<modelgbp::gbp::RoutingDomain>> o_rd =
+            pm.getRDForGroup(epgURI);
+        boost::optional<std::shared_ptr<modelgbp::gbp::BridgeDomain>> o_bd =
+            pm.getBDForGroup(epgURI);
+        boost::optional<std::shared_ptr<modelgbp::gbp::FloodDomain>> o_fd =
+            pm.getFDForGroup(epgURI);
+
+        if (o_rd) group.domains.insert(o_rd.get()->getURI());
+        if (o_bd) group.domains.insert(o_bd.get()->getURI());
+        if (o_fd) group.domains.insert(o_fd.get()->getURI());
+
         std::shared_ptr<interface> bvi = gepg->get_bridge_domain()->get_bvi();
         std::shared_ptr<bridge_domain> bd =
             gepg->get_bridge_domain()->get_bridge_domain();
@@ -546,6 +574,12 @@ EndPointGroupManager::handle_update(const opflex::modb::URI &epgURI)
 
         for (auto sn : subnets)
         {
+            /*
+             * a subnet added later arrives as an update to the EPG's
+             * domains, which renders the EPG
+             */
+            group.domains.insert(sn->getURI());
+
             boost::optional<boost::asio::ip::address> routerIp =
                 opflexagent::PolicyManager::getRouterIpForSubnet(*sn);
 
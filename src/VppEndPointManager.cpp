@@ -11,7 +11,10 @@
 #include <opflexagent/EndpointManager.h>
 #include <opflexagent/logging.h>
 
+#include <opflex/modb/Mutator.h>
+
 #include <modelgbp/gbp/RoutingModeEnumT.hpp>
+#include <modelgbp/gbpe/EpStatUniverse.hpp>
 #include <modelgbp/l2/EtherTypeEnumT.hpp>
 
 #include <vom/acl_binding.hpp>
@@ -36,8 +39,10 @@
 #include <vom/stat_reader.hpp>
 #include <vom/sub_interface.hpp>
 
+#include "VppAclRules.hpp"
 #include "VppEndPointGroupManager.hpp"
 #include "VppEndPointManager.hpp"
+#include "VppInterfaceRates.hpp"
 #include "VppLog.hpp"
 #include "VppSecurityGroupManager.hpp"
 #include "VppUtil.hpp"
@@ -47,8 +52,12 @@ using namespace boost;
 
 namespace VPP
 {
-EndPointManager::EndPointManager(Runtime &runtime)
+EndPointManager::EndPointManager(Runtime &runtime,
+                                 EndPointGroupManager &epgm,
+                                 SecurityGroupManager &sgm)
     : m_runtime(runtime)
+    , m_epgm(epgm)
+    , m_sgm(sgm)
 {
 }
 
@@ -228,72 +237,247 @@ get_ep_ips(const opflexagent::Endpoint &ep)
 }
 
 void
-EndPointManager::handle_interface_stat_i(const interface &itf)
+EndPointManager::index_interface(const std::string &uuid,
+                                 const handle_t &hdl,
+                                 const std::string &name)
 {
-    VLOGD << "Interface Stat: " << itf.to_string();
+    std::lock_guard<std::mutex> lg(m_itf_eps_mutex);
+
+    auto it = m_ep_itf.find(uuid);
+
+    if (it != m_ep_itf.end())
+    {
+        auto jt = m_itf_eps.find(it->second);
+
+        if (it->second == hdl.value() && jt != m_itf_eps.end() &&
+            jt->second.name == name)
+            return;
+
+        if (jt != m_itf_eps.end())
+        {
+            jt->second.eps.erase(uuid);
+            if (jt->second.eps.empty())
+            {
+                InterfaceRates::get().remove(jt->first);
+                m_itf_eps.erase(jt);
+            }
+        }
+        m_ep_itf.erase(it);
+    }
+
+    if (handle_t::INVALID == hdl) return;
+
+    m_itf_no_eps.erase(hdl.value());
+
+    itf_eps_t &itf_eps = m_itf_eps[hdl.value()];
+
+    if (itf_eps.name != name)
+    {
+        /*
+         * the handle was another interface's; its endpoints are stale
+         */
+        for (const std::string &ep : itf_eps.eps)
+            m_ep_itf.erase(ep);
+        itf_eps.eps.clear();
+        itf_eps.name = name;
+        InterfaceRates::get().remove(hdl.value());
+    }
+
+    m_ep_itf[uuid] = hdl.value();
+    itf_eps.eps.insert(uuid);
+}
+
+void
+EndPointManager::handle_interface_stat_i(const itf_stats_t &itf)
+{
+    VLOGD << "Interface Stat: " << itf.name;
 
     opflexagent::EndpointManager &epMgr = m_runtime.agent.getEndpointManager();
 
     opflexagent::EndpointManager::EpCounters counters;
     std::unordered_set<std::string> endpoints;
-    auto &data = itf.get_stats();
+    auto &data = itf.stats;
 
     VLOGD << "Stats data: " << data;
 
-    epMgr.getEndpointsByAccessIface(itf.name(), endpoints);
+    bool no_eps = false;
+
+    {
+        std::lock_guard<std::mutex> lg(m_itf_eps_mutex);
+        auto it = m_itf_eps.find(itf.handle.value());
+
+        if (it != m_itf_eps.end() && it->second.name == itf.name)
+            endpoints = it->second.eps;
+
+        auto jt = m_itf_no_eps.find(itf.handle.value());
+
+        no_eps = (jt != m_itf_no_eps.end() && jt->second == itf.name);
+    }
+
+    if (endpoints.empty() && !no_eps)
+    {
+        /*
+         * not rendered with this handle, e.g. VPP restarted and the
+         * interface was re-created, or the handle is now another
+         * interface's; find its endpoints the slow way and index them
+         * under the new handle.
+         */
+        epMgr.getEndpointsByAccessIface(itf.name, endpoints);
+
+        for (const std::string &uuid : endpoints)
+            index_interface(uuid, itf.handle, itf.name);
+
+        if (endpoints.empty())
+        {
+            std::lock_guard<std::mutex> lg(m_itf_eps_mutex);
+            m_itf_no_eps[itf.handle.value()] = itf.name;
+        }
+    }
+
+    InterfaceRates::drops_t drops = InterfaceRates::drops_t::from(data);
 
     memset(&counters, 0, sizeof(counters));
-    counters.txPackets = data.m_tx.packets;
-    counters.rxPackets = data.m_rx.packets;
-    counters.txBytes = data.m_tx.bytes;
-    counters.rxBytes = data.m_rx.bytes;
-    counters.rxUnicast = data.m_rx_unicast.packets;
-    counters.txUnicast = data.m_tx_unicast.packets;
-    counters.rxBroadcast = data.m_rx_broadcast.packets;
-    counters.txBroadcast = data.m_tx_broadcast.packets;
-    counters.rxMulticast = data.m_rx_multicast.packets;
-    counters.txMulticast = data.m_tx_multicast.packets;
-    // counters.txDrop = data.tx_dropped;
-    // counters.rxDrop = data.rx_dropped;
+    counters.txPackets = InterfaceRates::sanitize(data.m_tx.packets);
+    counters.rxPackets = InterfaceRates::sanitize(data.m_rx.packets);
+    counters.txBytes = InterfaceRates::sanitize(data.m_tx.bytes);
+    counters.rxBytes = InterfaceRates::sanitize(data.m_rx.bytes);
+    counters.rxUnicast = InterfaceRates::sanitize(data.m_rx_unicast.packets);
+    counters.txUnicast = InterfaceRates::sanitize(data.m_tx_unicast.packets);
+    counters.rxBroadcast =
+        InterfaceRates::sanitize(data.m_rx_broadcast.packets);
+    counters.txBroadcast =
+        InterfaceRates::sanitize(data.m_tx_broadcast.packets);
+    counters.rxMulticast =
+        InterfaceRates::sanitize(data.m_rx_multicast.packets);
+    counters.txMulticast =
+        InterfaceRates::sanitize(data.m_tx_multicast.packets);
+    counters.rxDrop = drops.rx();
+    counters.txDrop = drops.tx();
+
+    if (endpoints.empty()) return;
+
+    InterfaceRates::get().update(itf.handle.value(),
+                                 itf.name,
+                                 endpoints,
+                                 {itf.when,
+                                  counters.rxPackets,
+                                  counters.txPackets,
+                                  counters.rxBytes,
+                                  counters.txBytes,
+                                  drops});
 
     for (const std::string &uuid : endpoints)
+        m_counters.emplace_back(uuid, counters);
+}
+
+void
+EndPointManager::publish_counters()
+{
+    std::vector<itf_stats_t> stats;
+
     {
-        if (counters.rxDrop == std::numeric_limits<uint64_t>::max())
-            counters.rxDrop = 0;
-        if (counters.txDrop == std::numeric_limits<uint64_t>::max())
-            counters.txDrop = 0;
-        if (counters.txPackets == std::numeric_limits<uint64_t>::max())
-            counters.txPackets = 0;
-        if (counters.rxPackets == std::numeric_limits<uint64_t>::max())
-            counters.rxPackets = 0;
-        if (counters.txBroadcast == std::numeric_limits<uint64_t>::max())
-            counters.txBroadcast = 0;
-        if (counters.rxBroadcast == std::numeric_limits<uint64_t>::max())
-            counters.rxBroadcast = 0;
-        if (counters.txMulticast == std::numeric_limits<uint64_t>::max())
-            counters.txMulticast = 0;
-        if (counters.rxMulticast == std::numeric_limits<uint64_t>::max())
-            counters.rxMulticast = 0;
-        if (counters.txUnicast == std::numeric_limits<uint64_t>::max())
-            counters.txUnicast = 0;
-        if (counters.rxUnicast == std::numeric_limits<uint64_t>::max())
-            counters.rxUnicast = 0;
-        if (counters.rxBytes == std::numeric_limits<uint64_t>::max())
-            counters.rxBytes = 0;
-        if (counters.txBytes == std::numeric_limits<uint64_t>::max())
-            counters.txBytes = 0;
-        epMgr.updateEndpointCounters(uuid, counters);
+        std::lock_guard<std::mutex> lg(m_stats_mutex);
+        stats.swap(m_stats);
     }
+
+    for (auto &itf : stats)
+        handle_interface_stat_i(itf);
+
+    {
+        /*
+         * return the buffer, to keep its capacity for the next tick
+         */
+        std::lock_guard<std::mutex> lg(m_stats_mutex);
+        stats.clear();
+        if (m_stats.empty()) m_stats.swap(stats);
+    }
+
+    if (m_counters.empty()) return;
+
+    VLOGD << "Publish counters of " << m_counters.size() << " endpoints";
+
+    /*
+     * one transaction for the whole tick, rather than one per endpoint
+     */
+    opflex::modb::Mutator mutator(m_runtime.agent.getFramework(),
+                                  "policyelement");
+    optional<std::shared_ptr<modelgbp::gbpe::EpStatUniverse>> su =
+        modelgbp::gbpe::EpStatUniverse::resolve(
+            m_runtime.agent.getFramework());
+
+    if (su)
+    {
+        opflexagent::EndpointManager &epMgr =
+            m_runtime.agent.getEndpointManager();
+
+        for (auto &c : m_counters)
+        {
+            /*
+             * the agent removes an endpoint's counter with it; don't
+             * recreate the counter of one deleted since the stats were
+             * read
+             */
+            if (!epMgr.getEndpoint(c.first)) continue;
+
+            su.get()
+                ->addGbpeEpCounter(c.first)
+                ->setRxPackets(c.second.rxPackets)
+                .setTxPackets(c.second.txPackets)
+                .setRxDrop(c.second.rxDrop)
+                .setTxDrop(c.second.txDrop)
+                .setRxBroadcast(c.second.rxBroadcast)
+                .setTxBroadcast(c.second.txBroadcast)
+                .setRxMulticast(c.second.rxMulticast)
+                .setTxMulticast(c.second.txMulticast)
+                .setRxUnicast(c.second.rxUnicast)
+                .setTxUnicast(c.second.txUnicast)
+                .setRxBytes(c.second.rxBytes)
+                .setTxBytes(c.second.txBytes);
+        }
+    }
+    mutator.commit();
+
+    /*
+     * keep the buffer's capacity for the next tick
+     */
+    m_counters.clear();
 }
 
 void
 EndPointManager::handle_interface_stat(const interface &itf)
 {
-    handle_interface_stat_i(itf);
+    /*
+     * called as the stats are read, with VOM locked; take a copy and
+     * leave the work to publish_counters
+     */
+    std::lock_guard<std::mutex> lg(m_stats_mutex);
+
+    m_stats.push_back({itf.handle(),
+                       itf.name(),
+                       itf.get_stats(),
+                       std::chrono::steady_clock::now()});
 }
 
 void
 EndPointManager::handle_update_i(const std::string &uuid, bool is_external)
+{
+    handle_t hdl = handle_t::INVALID;
+    std::string name;
+
+    render_i(uuid, is_external, hdl, name);
+
+    /*
+     * the endpoint's interface, if any, now that the stale state has
+     * been swept
+     */
+    index_interface(uuid, hdl, name);
+}
+
+void
+EndPointManager::render_i(const std::string &uuid,
+                          bool is_external,
+                          handle_t &itf_hdl,
+                          std::string &itf_name)
 {
     /*
      * This is an update to all the state related to this endpoint.
@@ -301,6 +485,8 @@ EndPointManager::handle_update_i(const std::string &uuid, bool is_external)
      * that we don't touch here, gone.
      */
     OM::mark_n_sweep ms(uuid);
+    MulticastGroups::sweep mcs(m_runtime.mcast, uuid);
+    AclRules::get().remove(uuid);
     system::error_code ec;
     int rv;
 
@@ -311,6 +497,7 @@ EndPointManager::handle_update_i(const std::string &uuid, bool is_external)
     if (!epWrapper)
     {
         VLOGD << "Deleting endpoint " << uuid;
+        m_sgm.release(uuid);
         return;
     }
     VLOGD << "Updating endpoint " << uuid;
@@ -330,9 +517,18 @@ EndPointManager::handle_update_i(const std::string &uuid, bool is_external)
         return;
     }
 
-    std::shared_ptr<VOM::gbp_endpoint_group> gepg =
-        EndPointGroupManager::mk_group(
+    /*
+     * The forwarding state of an internal EPG is shared by all its
+     * endpoints, so use the EPG's rendered group. External EPs render
+     * the group of the external interface for themselves.
+     */
+    std::shared_ptr<VOM::gbp_endpoint_group> gepg;
+
+    if (is_external)
+        gepg = EndPointGroupManager::mk_group(
             m_runtime, uuid, epgURI.get(), is_external);
+    else
+        gepg = m_epgm.get_group(epgURI.get());
 
     if (gepg)
     {
@@ -355,19 +551,19 @@ EndPointManager::handle_update_i(const std::string &uuid, bool is_external)
             /**
              * We are interested in getting detailed interface stats from VPP
              */
-            itf->enable_stats(this);
+            m_runtime.stats.add(itf, StatsTiers::class_t::ENDPOINT, this);
+            itf_hdl = itf->handle();
+            itf_name = itf->name();
 
             /*
              * Apply Security Groups
              */
             const opflexagent::EndpointListener::uri_set_t &secGrps =
                 ep.getSecurityGroups();
-            const std::string secGrpId = SecurityGroupManager::get_id(secGrps);
-            std::hash<std::string> string_hash;
-            const std::string secGrpKey = std::to_string(string_hash(secGrpId));
 
             ACL::l3_list::rules_t in_rules, out_rules;
             ACL::acl_ethertype::ethertype_rules_t ethertype_rules;
+            AclRules::origins_t in_origins, out_origins;
 
             optional<opflexagent::Endpoint::DHCPv4Config> v4c =
                 ep.getDHCPv4Config();
@@ -396,12 +592,13 @@ EndPointManager::handle_update_i(const std::string &uuid, bool is_external)
                                    modelgbp::l2::EtherTypeEnumT::CONST_IPV6);
             }
 
-            SecurityGroupManager::build_update(m_runtime.agent,
-                                               secGrps,
-                                               secGrpId,
-                                               in_rules,
-                                               out_rules,
-                                               ethertype_rules);
+            m_sgm.get_rules(uuid,
+                            secGrps,
+                            in_rules,
+                            out_rules,
+                            ethertype_rules,
+                            in_origins,
+                            out_origins);
 
             if (!ethertype_rules.empty())
             {
@@ -410,16 +607,21 @@ EndPointManager::handle_update_i(const std::string &uuid, bool is_external)
             }
             if (!in_rules.empty())
             {
-                ACL::l3_list in_acl(secGrpKey + "-in", in_rules);
+                ACL::l3_list in_acl(
+                    SecurityGroupManager::get_acl_name(in_rules), in_rules);
                 OM::write(uuid, in_acl);
+                AclRules::get().add(uuid, in_acl.key(), in_rules, in_origins);
 
                 ACL::l3_binding in_binding(direction_t::INPUT, *itf, in_acl);
                 OM::write(uuid, in_binding);
             }
             if (!out_rules.empty())
             {
-                ACL::l3_list out_acl(secGrpKey + "-out", out_rules);
+                ACL::l3_list out_acl(
+                    SecurityGroupManager::get_acl_name(out_rules), out_rules);
                 OM::write(uuid, out_acl);
+                AclRules::get().add(
+                    uuid, out_acl.key(), out_rules, out_origins);
 
                 ACL::l3_binding out_binding(direction_t::OUTPUT, *itf, out_acl);
                 OM::write(uuid, out_binding);
@@ -727,6 +929,20 @@ EndPointManager::handle_update(const std::string &uuid)
     handle_update_i(uuid, false);
 }
 void
+EndPointManager::handle_batch_update(
+    const std::unordered_set<std::string> &uuids)
+{
+    VLOGD << "Updating endpoint batch of " << uuids.size();
+
+    /*
+     * one endpoint at a time; VOM flushes as each object is written
+     */
+    for (const std::string &uuid : uuids)
+    {
+        handle_update_i(uuid, false);
+    }
+}
+void
 EndPointManager::handle_external_update(const std::string &uuid)
 {
     handle_update_i(uuid, true);
@@ -12,7 +12,6 @@
 #include <opflexagent/PolicyManager.h>
 
 #include <modelgbp/gbp/ExternalInterface.hpp>
-#include <modelgbp/gbp/L3ExternalDomain.hpp>
 #include <modelgbp/gbp/Subnet.hpp>
 
 #include <vom/bridge_domain_arp_entry.hpp>
@@ -24,7 +23,6 @@
 #include "VppEndPointGroupManager.hpp"
 #include "VppExtItfManager.hpp"
 #include "VppLog.hpp"
-#include "VppRouteManager.hpp"
 #include "VppUtil.hpp"
 
 using namespace VOM;
@@ -40,6 +38,7 @@ void
 ExtItfManager::handle_update(const opflex::modb::URI &uri)
 {
     OM::mark_n_sweep ms(uri.toString());
+    MulticastGroups::sweep mcs(m_runtime.mcast, uri.toString());
     const std::string &uuid = uri.toString();
 
     boost::optional<std::shared_ptr<modelgbp::gbp::ExternalInterface>> ext_itf =
@@ -165,18 +164,9 @@ ExtItfManager::handle_update(const opflex::modb::URI &uri)
     OM::write(uuid, gei);
 
     /*
-     * Add any external networks
+     * the external networks are rendered by RouteManager::handle_ext_nets,
+     * in the RD's route batch
      */
-    boost::optional<std::shared_ptr<modelgbp::gbp::L3ExternalDomain>> ext_dom =
-        m_runtime.policy_manager().getExternalDomainForExternalInterface(uri);
-
-    if (!ext_dom)
-    {
-        VLOGI << "External-Interface; no ExternalDomain: " << uri;
-        return;
-    }
-
-    RouteManager::mk_ext_nets(m_runtime, rd, uri, ext_dom.get());
 }
 
 }; // namepsace VPP
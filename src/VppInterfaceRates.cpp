@@ -0,0 +1,248 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <cmath>
+#include <iomanip>
+
+#include "VppInterfaceRates.hpp"
+
+namespace VPP
+{
+InterfaceRates::InterfaceRates(std::chrono::seconds tau)
+    : m_tau(tau.count())
+{
+}
+
+InterfaceRates &
+InterfaceRates::get()
+{
+    /*
+     * never destroyed, as inspect may hold it until exit
+     */
+    static InterfaceRates *instance = []() {
+        InterfaceRates *r = new InterfaceRates();
+
+        VOM::inspect::register_handler(
+            {"rates"}, "Endpoint interface rates", r);
+        return r;
+    }();
+
+    return *instance;
+}
+
+uint64_t
+InterfaceRates::sanitize(uint64_t value)
+{
+    /*
+     * branch-free, as it's applied to every counter of every interface
+     */
+    return (value & (0 - (uint64_t)(value != ~0ULL)));
+}
+
+InterfaceRates::drops_t
+InterfaceRates::drops_t::from(const VOM::interface::stats_t &stats)
+{
+    return {sanitize(stats.m_drop.packets),
+            sanitize(stats.m_rx_miss.packets),
+            sanitize(stats.m_rx_no_buf.packets),
+            sanitize(stats.m_rx_error.packets),
+            sanitize(stats.m_tx_error.packets)};
+}
+
+uint64_t
+InterfaceRates::drops_t::rx() const
+{
+    return (drop + rx_miss + rx_no_buf + rx_error);
+}
+
+uint64_t
+InterfaceRates::drops_t::tx() const
+{
+    return (tx_error);
+}
+
+static double
+per_sec(uint64_t from, uint64_t to, double secs)
+{
+    return ((to - from) / secs);
+}
+
+static double
+ewma(double average, double value, double alpha)
+{
+    return (average + alpha * (value - average));
+}
+
+void
+InterfaceRates::update(uint32_t handle,
+                       const std::string &name,
+                       const std::unordered_set<std::string> &endpoints,
+                       const sample_t &sample)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    auto it = m_rates.find(handle);
+
+    if (it == m_rates.end())
+    {
+        itf_rates_t r = {name, endpoints, sample, false, {}, {}};
+        m_rates.emplace(handle, r);
+        return;
+    }
+
+    itf_rates_t &r = it->second;
+    const sample_t &prev = r.sample;
+    double secs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      sample.when - prev.when)
+                      .count() /
+                  1000.0;
+
+    r.name = name;
+    r.endpoints = endpoints;
+
+    /*
+     * counters that go backwards have been reset, e.g. VPP restarted;
+     * there's no rate for this interval, start again from this sample
+     */
+    if (secs > 0 && sample.rx_packets >= prev.rx_packets &&
+        sample.tx_packets >= prev.tx_packets &&
+        sample.rx_bytes >= prev.rx_bytes &&
+        sample.tx_bytes >= prev.tx_bytes &&
+        sample.drops.rx() >= prev.drops.rx() &&
+        sample.drops.tx() >= prev.drops.tx())
+    {
+        rate_t rate = {
+            per_sec(prev.rx_packets, sample.rx_packets, secs),
+            per_sec(prev.tx_packets, sample.tx_packets, secs),
+            per_sec(prev.rx_bytes, sample.rx_bytes, secs) * 8,
+            per_sec(prev.tx_bytes, sample.tx_bytes, secs) * 8,
+            per_sec(prev.drops.rx(), sample.drops.rx(), secs),
+            per_sec(prev.drops.tx(), sample.drops.tx(), secs)};
+
+        /*
+         * the samples are not evenly spaced, so weight each by the
+         * interval it covers
+         */
+        double alpha = 1 - std::exp(-secs / m_tau);
+
+        if (r.has_rate)
+        {
+            r.average.rx_pps = ewma(r.average.rx_pps, rate.rx_pps, alpha);
+            r.average.tx_pps = ewma(r.average.tx_pps, rate.tx_pps, alpha);
+            r.average.rx_bps = ewma(r.average.rx_bps, rate.rx_bps, alpha);
+            r.average.tx_bps = ewma(r.average.tx_bps, rate.tx_bps, alpha);
+            r.average.rx_drop_pps =
+                ewma(r.average.rx_drop_pps, rate.rx_drop_pps, alpha);
+            r.average.tx_drop_pps =
+                ewma(r.average.tx_drop_pps, rate.tx_drop_pps, alpha);
+        }
+        else
+        {
+            r.average = rate;
+        }
+        r.last = rate;
+        r.has_rate = true;
+    }
+
+    r.sample = sample;
+}
+
+void
+InterfaceRates::remove(uint32_t handle)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    m_rates.erase(handle);
+}
+
+boost::optional<InterfaceRates::rate_t>
+InterfaceRates::last(uint32_t handle) const
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    auto it = m_rates.find(handle);
+
+    if (it == m_rates.end() || !it->second.has_rate) return boost::none;
+
+    return it->second.last;
+}
+
+boost::optional<InterfaceRates::rate_t>
+InterfaceRates::average(uint32_t handle) const
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    auto it = m_rates.find(handle);
+
+    if (it == m_rates.end() || !it->second.has_rate) return boost::none;
+
+    return it->second.average;
+}
+
+static void
+show_rate(std::ostream &os,
+          const std::string &name,
+          const InterfaceRates::rate_t &r)
+{
+    os << "  " << std::left << std::setw(8) << name << std::right
+       << " rx-pps:" << std::setw(12) << r.rx_pps << " tx-pps:"
+       << std::setw(12) << r.tx_pps << " rx-bps:" << std::setw(14)
+       << r.rx_bps << " tx-bps:" << std::setw(14) << r.tx_bps
+       << " rx-drop-pps:" << std::setw(10) << r.rx_drop_pps
+       << " tx-drop-pps:" << std::setw(10) << r.tx_drop_pps << std::endl;
+}
+
+static void
+show_drops(std::ostream &os, const InterfaceRates::drops_t &d)
+{
+    os << "  drops    drop:" << d.drop << " rx-miss:" << d.rx_miss
+       << " rx-no-buf:" << d.rx_no_buf << " rx-error:" << d.rx_error
+       << " tx-error:" << d.tx_error << std::endl;
+}
+
+void
+InterfaceRates::show(std::ostream &os)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    /*
+     * the rates are shown to one decimal place; the caller's stream is
+     * restored after
+     */
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+
+    os << std::fixed << std::setprecision(1);
+
+    for (auto &r : m_rates)
+    {
+        os << r.second.name << " [" << r.first << "]";
+        for (auto &uuid : r.second.endpoints)
+            os << " " << uuid;
+        os << std::endl;
+
+        show_drops(os, r.second.sample.drops);
+
+        if (!r.second.has_rate) continue;
+
+        show_rate(os, "last", r.second.last);
+        show_rate(os, "average", r.second.average);
+    }
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
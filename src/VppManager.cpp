@@ -7,15 +7,25 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/system/error_code.hpp>
 
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <modelgbp/gbp/RoutingDomain.hpp>
+#include <vom/interface_cmds.hpp>
+
 #include "VppContractManager.hpp"
 #include "VppEndPointGroupManager.hpp"
 #include "VppEndPointManager.hpp"
@@ -25,6 +35,7 @@
 #include "VppManager.hpp"
 #include "VppRouteManager.hpp"
 #include "VppSecurityGroupManager.hpp"
+#include "VppTaskStats.hpp"
 
 #include <opflexagent/EndpointManager.h>
 
@@ -38,13 +49,133 @@ namespace VPP
  */
 static const std::string BOOT_KEY = "__boot__";
 
+/**
+ * The task-queue ID used for rendering a batch of endpoints
+ */
+static const std::string EP_BATCH_ID = "__endpoint-batch__";
+
+/**
+ * The task-queue ID used for rendering a batch of routes
+ */
+static const std::string ROUTE_BATCH_ID = "__route-batch__";
+
+/**
+ * The bounds on each chunk of the boot sweep; the number of objects
+ * removed and the time, in ms, spent removing them
+ */
+static const uint32_t BOOT_SWEEP_CHUNK = 64;
+static const uint32_t BOOT_SWEEP_BUDGET = 10;
+
+/**
+ * The interval, in ms, at which convergence is checked before the
+ * boot sweep
+ */
+static const uint32_t SWEEP_CHECK_INTERVAL = 500;
+
+/**
+ * The bounds, in ms, of the backoff between attempts to connect to VPP
+ */
+static const uint32_t CONNECT_BACKOFF_MIN = 100;
+static const uint32_t CONNECT_BACKOFF_MAX = 10000;
+
+/**
+ * The number of reconnects after which a task whose writes still fail
+ * is dropped; VPP refused them, rather than lost them with the connection
+ */
+static const uint32_t FAILED_TASK_MAX_RETRIES = 3;
+
+/**
+ * The niceness of the thread that reads the stats
+ */
+static const int STATS_NICE = 10;
+
+/**
+ * Read the interfaces from VPP
+ */
+static std::shared_ptr<VOM::interface_cmds::dump_cmd>
+dump_interfaces()
+{
+    std::shared_ptr<VOM::interface_cmds::dump_cmd> cmd =
+        std::make_shared<VOM::interface_cmds::dump_cmd>();
+
+    VOM::HW::enqueue(cmd);
+    VOM::HW::write();
+
+    return cmd;
+}
+
+/**
+ * Determine, after reconnecting, whether VPP still holds the state that
+ * was programmed, i.e. only the API connection was lost, or whether it
+ * restarted. Every interface VPP reports with a handle we know must have
+ * the name we know, and the uplink sub-interface we created, which is
+ * not part of VPP's startup config, must still be there.
+ */
+static bool
+vpp_state_survived(const std::shared_ptr<interface> &uplink)
+{
+    /*
+     * without the uplink there's nothing that proves VPP kept its state
+     */
+    if (!uplink || handle_t::INVALID == uplink->handle()) return false;
+
+    std::shared_ptr<VOM::interface_cmds::dump_cmd> cmd = dump_interfaces();
+    bool uplink_found = false;
+    uint32_t n_known = 0;
+
+    for (auto &record : *cmd)
+    {
+        auto &payload = record.get_payload();
+        const VOM::handle_t hdl(payload.sw_if_index);
+        const std::string name =
+            reinterpret_cast<const char *>(payload.interface_name);
+        std::shared_ptr<interface> itf = interface::find(hdl);
+
+        if (!itf) continue;
+
+        if (itf->name() != name)
+        {
+            VLOGD << "VPP restarted; " << name << " has the handle of "
+                  << itf->name();
+            return false;
+        }
+        n_known++;
+
+        if (uplink->handle() == hdl) uplink_found = true;
+    }
+
+    if (!uplink_found)
+    {
+        VLOGD << "VPP restarted; " << uplink->name() << " is gone";
+        return false;
+    }
+
+    return (0 != n_known);
+}
+
 VppManager::VppManager(opflexagent::Agent &agent_,
                        opflexagent::IdGenerator &idGen_,
                        VOM::HW::cmd_q *q,
                        VOM::stat_reader *sr)
     : m_runtime(agent_, idGen_)
     , m_task_queue(agent_.getAgentIOService())
+    , m_sweep_quiet(5000)
+    , m_sweep_max(300)
+    , m_boot_swept(false)
+    , m_boot_stale_remaining(0)
+    , m_ep_batch_armed(false)
+    , m_ep_batch_window(10)
+    , m_ep_batch_max(512)
+    , m_route_batch_armed(false)
+    , m_route_batch_window(10)
+    , m_route_batch_max(1024)
     , stopping(false)
+    , m_conn_state(connection_state_t::DISCONNECTED)
+    , m_running(0)
+    , m_untracked_seen(0)
+    , m_replay_all(false)
+    , m_connect_backoff(CONNECT_BACKOFF_MIN)
+    , m_connect_rand(std::random_device()())
 {
     VOM::HW::init(q, sr);
     VOM::OM::init();
@@ -55,6 +186,8 @@ VppManager::VppManager(opflexagent::Agent &agent_,
 
 VppManager::~VppManager()
 {
+    stopStats();
+
     VLOGE << "VppManager exiting";
 }
 
@@ -70,48 +203,223 @@ VppManager::start()
     m_runtime.is_transport_mode =
         (opflex::ofcore::OFConstants::TRANSPORT_MODE ==
          m_runtime.agent.getRendererForwardingMode());
-    m_epm = std::make_shared<EndPointManager>(m_runtime);
     m_epgm = std::make_shared<EndPointGroupManager>(m_runtime);
     m_sgm = std::make_shared<SecurityGroupManager>(m_runtime.agent);
+    m_epm = std::make_shared<EndPointManager>(m_runtime, *m_epgm, *m_sgm);
     m_cm = std::make_shared<ContractManager>(m_runtime.agent, m_runtime.id_gen);
     m_rdm = std::make_shared<RouteManager>(m_runtime);
     m_eim = std::make_shared<ExtItfManager>(m_runtime);
 
     initPlatformConfig();
 
+    m_stats_work.reset(new boost::asio::io_service::work(m_stats_io));
+    m_stats_thread = std::thread(bind(&VppManager::runStats, this));
+
+    {
+        std::lock_guard<std::mutex> lg(m_conn_mutex);
+        m_conn_state = connection_state_t::CONNECTING;
+    }
+
     /*
-     * make sure the first event in the task Q is the blocking
-     * connection initiation to VPP ...
+     * make sure the first event in the task Q is the connection
+     * initiation to VPP. Updates received until it succeeds are held.
      */
-    m_task_queue.dispatch("init-connection",
-                          bind(&VppManager::handleInitConnection, this));
+    queueTask("init-connection",
+              {"connect",
+               bind(&VppManager::handleInitConnection, this)});
+}
 
-    /**
-     * DO BOOT
-     */
+VppManager::connection_state_t
+VppManager::getConnectionState()
+{
+    std::lock_guard<std::mutex> lg(m_conn_mutex);
 
-    /**
-     * ... followed by vpp boot dump
+    return m_conn_state;
+}
+
+void
+VppManager::dispatch(const std::string &type,
+                     const std::string &id,
+                     const std::function<void()> &func)
+{
+    dispatchTask(id, {type, func});
+}
+
+void
+VppManager::dispatchTask(const std::string &id, const task_t &task)
+{
+    {
+        std::lock_guard<std::mutex> lg(m_conn_mutex);
+
+        m_last_update = std::chrono::steady_clock::now();
+
+        if (connection_state_t::CONNECTED != m_conn_state)
+        {
+            /*
+             * as the task-queue does, keep only the latest update for
+             * an ID
+             */
+            if (m_pending.find(id) == m_pending.end())
+                m_pending_order.push_back(id);
+            m_pending[id] = task;
+            return;
+        }
+    }
+
+    /*
+     * queued without the lock; the task-queue may run the task in
+     * place, and the task may dispatch others
      */
-    m_task_queue.dispatch("boot-dump", bind(&VppManager::handleBoot, this));
+    queueTask(id, task);
+}
 
-    /**
-     * ... followed by uplink configuration
+void
+VppManager::queueTask(const std::string &id, const task_t &task)
+{
+    {
+        std::lock_guard<std::mutex> lg(m_queued_mutex);
+
+        /*
+         * a task replacing one still queued is measured from when the
+         * first was queued
+         */
+        m_queued.emplace(id, std::chrono::steady_clock::now());
+        TaskStats::get().queued(m_queued.size());
+    }
+
+    auto run = [this, task, id]() {
+        std::chrono::steady_clock::time_point queued =
+            std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lg(m_queued_mutex);
+            auto it = m_queued.find(id);
+
+            if (it != m_queued.end())
+            {
+                queued = it->second;
+                m_queued.erase(it);
+            }
+            TaskStats::get().queued(m_queued.size());
+        }
+
+        /*
+         * VOM's object model is shared with the stats thread
+         */
+        std::lock_guard<std::recursive_mutex> lg(m_runtime.om_mutex);
+
+        m_running++;
+        bool failed = TaskStats::get().run(task.type, queued, task.func);
+        m_running--;
+
+        /*
+         * remember the tasks whose writes failed, to retry them if the
+         * connection was lost; a later run that succeeds supersedes it
+         */
+        std::lock_guard<std::mutex> flg(m_failed_mutex);
+
+        if (failed)
+        {
+            if (m_failed.find(id) == m_failed.end())
+                m_failed_order.push_back(id);
+            m_failed[id] = task;
+        }
+        else
+        {
+            m_failed.erase(id);
+            m_retries.erase(id);
+        }
+    };
+
+    m_task_queue.dispatch(id, run);
+}
+
+void
+VppManager::holdFailedTasks()
+{
+    std::vector<std::pair<std::string, task_t>> failed;
+
+    {
+        std::lock_guard<std::mutex> lg(m_failed_mutex);
+
+        for (auto &id : m_failed_order)
+        {
+            auto it = m_failed.find(id);
+
+            if (it == m_failed.end()) continue;
+
+            if (++m_retries[id] > FAILED_TASK_MAX_RETRIES)
+            {
+                VLOGW << "Drop task " << id << " whose writes failed "
+                      << FAILED_TASK_MAX_RETRIES << " retries";
+                m_retries.erase(id);
+                continue;
+            }
+            failed.push_back(*it);
+        }
+        m_failed.clear();
+        m_failed_order.clear();
+    }
+
+    VLOGI << "Retry " << failed.size() << " tasks whose writes failed";
+
+    std::lock_guard<std::mutex> lg(m_conn_mutex);
+
+    /*
+     * the failed tasks are older than those held, so they go first,
+     * unless a later update to the ID is held
      */
-    m_task_queue.dispatch("uplink-configure",
-                          bind(&VppManager::handleUplinkConfigure, this));
+    for (auto it = failed.rbegin(); it != failed.rend(); ++it)
+    {
+        if (m_pending.find(it->first) != m_pending.end()) continue;
 
-    /**
-     * ... followed by cross connect configuration
+        m_pending_order.push_front(it->first);
+        m_pending[it->first] = it->second;
+    }
+}
+
+void
+VppManager::handleConnected()
+{
+    /*
+     * the held updates are queued without the lock, as any task is.
+     * those that arrive meanwhile are held, and released after, so
+     * the state changes to connected only once none are held.
      */
-    m_task_queue.dispatch("xconnect-configure",
-                          bind(&VppManager::handleXConnectConfigure, this));
+    while (true)
+    {
+        std::unordered_map<std::string, task_t> pending;
+        std::deque<std::string> order;
+
+        {
+            std::lock_guard<std::mutex> lg(m_conn_mutex);
+
+            if (m_pending_order.empty())
+            {
+                m_conn_state = connection_state_t::CONNECTED;
+                return;
+            }
+            pending.swap(m_pending);
+            order.swap(m_pending_order);
+        }
+
+        VLOGI << "VPP connected; releasing " << order.size()
+              << " held updates";
+
+        for (auto &id : order)
+            queueTask(id, pending[id]);
+    }
 }
 
 void
 VppManager::handleCloseConnection()
 {
-    if (!hw_connected) return;
+    {
+        std::lock_guard<std::mutex> lg(m_conn_mutex);
+
+        if (connection_state_t::CONNECTED != m_conn_state) return;
+
+        m_conn_state = connection_state_t::DISCONNECTED;
+    }
 
     VOM::interface::disable_events();
     VOM::HW::disconnect();
@@ -126,10 +434,30 @@ VppManager::handleInitConnection()
 
     VLOGD << "Open VPP connection";
 
-    while (VOM::HW::connect() != true)
-        ;
+    if (!VOM::HW::connect())
+    {
+        /*
+         * VPP is not up yet. Try again after a jittered and exponentially
+         * increasing backoff, leaving the IO service free meanwhile.
+         */
+        uint32_t backoff = std::uniform_int_distribution<uint32_t>(
+            m_connect_backoff / 2, m_connect_backoff)(m_connect_rand);
+
+        VLOGD << "VPP connect failed; retry in " << backoff << "ms";
+
+        m_connect_backoff =
+            std::min(2 * m_connect_backoff, CONNECT_BACKOFF_MAX);
+
+        m_connect_timer.reset(new boost::asio::deadline_timer(
+            m_runtime.agent.getAgentIOService()));
+        m_connect_timer->expires_from_now(
+            boost::posix_time::milliseconds(backoff));
+        m_connect_timer->async_wait(
+            bind(&VppManager::handleConnectTimer, this, error));
+        return;
+    }
 
-    hw_connected = true;
+    m_connect_backoff = CONNECT_BACKOFF_MIN;
 
     /**
      * We are insterested in getting interface events from VPP
@@ -145,13 +473,49 @@ VppManager::handleInitConnection()
     m_poll_timer->async_wait(bind(&VppManager::handleHWPollTimer, this, error));
 
     /**
-     * Scehdule a timer for HW stats
+     * Scehdule a timer for HW stats, in the stats thread
      */
-    m_stats_timer.reset(
-        new boost::asio::deadline_timer(m_runtime.agent.getAgentIOService()));
-    m_stats_timer->expires_from_now(boost::posix_time::seconds(5));
-    m_stats_timer->async_wait(
-        bind(&VppManager::handleHWStatsTimer, this, error));
+    m_stats_io.post(bind(&VppManager::armStatsTimer, this));
+
+    /**
+     * DO BOOT
+     */
+
+    /**
+     * ... vpp boot dump
+     */
+    queueTask("boot-dump",
+              {"boot",
+               bind(&VppManager::handleBoot, this)});
+
+    /**
+     * ... followed by uplink configuration
+     */
+    queueTask("uplink-configure",
+              {"boot",
+               bind(&VppManager::handleUplinkConfigure, this)});
+
+    /**
+     * ... followed by cross connect configuration
+     */
+    queueTask("xconnect-configure",
+              {"boot",
+               bind(&VppManager::handleXConnectConfigure, this)});
+
+    /**
+     * ... followed by the updates held while connecting
+     */
+    handleConnected();
+}
+
+void
+VppManager::handleConnectTimer(const boost::system::error_code &ec)
+{
+    if (stopping || ec) return;
+
+    queueTask("init-connection",
+              {"connect",
+               bind(&VppManager::handleInitConnection, this)});
 }
 
 void
@@ -170,26 +534,158 @@ VppManager::handleXConnectConfigure()
     m_xconnect.configure_xconnect();
 }
 
+bool
+VppManager::isConverged()
+{
+    {
+        std::lock_guard<std::mutex> lg(m_ep_batch_mutex);
+
+        if (!m_ep_batch.empty()) return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(m_route_batch_mutex);
+
+        if (!m_route_batch.routes.empty() || !m_route_batch.ext_nets.empty())
+            return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(m_queued_mutex);
+
+        if (!m_queued.empty() || m_running) return false;
+    }
+
+    std::lock_guard<std::mutex> lg(m_conn_mutex);
+
+    return (connection_state_t::CONNECTED == m_conn_state &&
+            m_pending.empty() &&
+            std::chrono::steady_clock::now() - m_last_update >=
+                std::chrono::milliseconds(m_sweep_quiet));
+}
+
+void
+VppManager::armSweepTimer()
+{
+    m_sweep_timer.reset(
+        new boost::asio::deadline_timer(m_runtime.agent.getAgentIOService()));
+    m_sweep_timer->expires_from_now(
+        boost::posix_time::milliseconds(SWEEP_CHECK_INTERVAL));
+    m_sweep_timer->async_wait(bind(&VppManager::handleSweepTimer, this, error));
+}
+
 void
 VppManager::handleSweepTimer(const boost::system::error_code &ec)
 {
-    if (stopping || ec) return;
+    if (stopping || ec || m_boot_swept) return;
+
+    /*
+     * Sweeping too early deletes state that is about to be re-created,
+     * so wait until all the updates received have been rendered.
+     */
+    if (isConverged())
+    {
+        VLOGI << "Renderer converged; sweep boot data";
+        m_boot_swept = true;
+        dispatch("boot-sweep",
+                 "boot-sweep",
+                 bind(&VppManager::handleBootSweep, this));
+    }
+    else if (connection_state_t::CONNECTED == getConnectionState() &&
+             std::chrono::steady_clock::now() - m_sweep_start >=
+                 std::chrono::seconds(m_sweep_max))
+    {
+        VLOGW << "Renderer not converged after " << m_sweep_max
+              << "s; sweep boot data";
+        m_boot_swept = true;
+        dispatch("boot-sweep",
+                 "boot-sweep",
+                 bind(&VppManager::handleBootSweep, this));
+    }
+    else
+    {
+        armSweepTimer();
+    }
+}
+
+void
+VppManager::handleBootSweep()
+{
+    if (stopping) return;
 
     VLOGI << "sweep boot data";
 
     /*
-     * the sweep timer was not cancelled, continue with purging old state.
+     * Removing an interface is the costliest delete, and it's
+     * interfaces there are most of at boot. Hold a reference to each
+     * so the sweep releases only the objects that depend on them, then
+     * remove the interfaces no one else wants a chunk at a time.
+     * The other objects are removed by the one sweep: OM::sweep(key)
+     * flushes all of the key's objects at once, and the OM has no way
+     * to list them, so there's nothing to hold a reference to bar
+     * those, like the interfaces, that can be found from a dump.
      */
-    if (hw_connected)
-        VOM::OM::sweep(BOOT_KEY);
-    else if (!stopping)
+    std::shared_ptr<VOM::interface_cmds::dump_cmd> cmd = dump_interfaces();
+
+    for (auto &record : *cmd)
     {
-        m_sweep_timer.reset(new boost::asio::deadline_timer(
-            m_runtime.agent.getAgentIOService()));
-        m_sweep_timer->expires_from_now(boost::posix_time::seconds(30));
-        m_sweep_timer->async_wait(
-            bind(&VppManager::handleSweepTimer, this, error));
+        std::shared_ptr<interface> itf =
+            interface::find(handle_t(record.get_payload().sw_if_index));
+
+        if (itf) m_boot_stale.push_back(itf);
+    }
+
+    VOM::OM::sweep(BOOT_KEY);
+
+    m_boot_stale.erase(
+        std::remove_if(m_boot_stale.begin(),
+                       m_boot_stale.end(),
+                       [](const std::shared_ptr<interface> &itf) {
+                           return (itf.use_count() > 1);
+                       }),
+        m_boot_stale.end());
+    m_boot_stale_remaining = m_boot_stale.size();
+    TaskStats::get().boot_stale(m_boot_stale_remaining);
+
+    handleBootSweepChunk();
+}
+
+void
+VppManager::handleBootSweepChunk()
+{
+    auto start = std::chrono::steady_clock::now();
+    uint32_t n = 0;
+
+    while (!m_boot_stale.empty() && n < BOOT_SWEEP_CHUNK &&
+           std::chrono::steady_clock::now() - start <
+               std::chrono::milliseconds(BOOT_SWEEP_BUDGET))
+    {
+        m_boot_stale.pop_front();
+        VOM::HW::write();
+        n++;
     }
+    m_boot_stale_remaining = m_boot_stale.size();
+    TaskStats::get().boot_stale(m_boot_stale_remaining);
+
+    VLOGD << "boot sweep removed:" << n
+          << " remaining:" << m_boot_stale_remaining;
+
+    /*
+     * yield to the other updates before the next chunk. it's posted,
+     * so it's queued behind them even if this task was run in place.
+     */
+    if (!m_boot_stale.empty())
+        m_runtime.agent.getAgentIOService().post([this]() {
+            dispatch("boot-sweep",
+                     "boot-sweep",
+                     bind(&VppManager::handleBootSweepChunk, this));
+        });
+}
+
+uint32_t
+VppManager::getBootSweepRemaining() const
+{
+    return m_boot_stale_remaining;
 }
 
 void
@@ -197,8 +693,18 @@ VppManager::handleHWPollTimer(const boost::system::error_code &ec)
 {
     if (stopping || ec) return;
 
-    if (hw_connected && VOM::HW::poll())
+    std::lock_guard<std::recursive_mutex> lg(m_runtime.om_mutex);
+    uint64_t untracked = TaskStats::get().untracked_failures();
+
+    if (connection_state_t::CONNECTED == getConnectionState() &&
+        VOM::HW::poll())
     {
+        /*
+         * VPP was there, so any writes that failed were refused by it,
+         * and replaying them won't change its mind
+         */
+        m_untracked_seen = TaskStats::get().untracked_failures();
+
         /*
          * re-scehdule a timer to Poll for HW liveness
          */
@@ -210,14 +716,51 @@ VppManager::handleHWPollTimer(const boost::system::error_code &ec)
         return;
     }
 
-    hw_connected = false;
+    {
+        /*
+         * hold the updates until the state is replayed
+         */
+        std::lock_guard<std::mutex> lg(m_conn_mutex);
+        m_conn_state = connection_state_t::CONNECTING;
+    }
+
+    /*
+     * writes made outside of a task that failed since the last poll,
+     * other than the poll's own, can only be recovered by a replay
+     */
+    if (untracked != m_untracked_seen) m_replay_all = true;
+    m_untracked_seen = TaskStats::get().untracked_failures();
+
     VOM::HW::disconnect();
     VLOGD << "Reconnecting ....";
     if (VOM::HW::connect())
     {
-        VLOGD << "Replay the state after reconnecting ...";
-        VOM::OM::replay();
-        hw_connected = true;
+        /*
+         * A full replay re-sends every object. It's only needed if VPP
+         * restarted; if only the API connection was lost then VPP still
+         * has the state, but not that of the commands sent while it was
+         * away. Those failed, and the tasks that sent them are run
+         * again, so their objects re-send what VPP does not have.
+         */
+        if (!m_replay_all &&
+            vpp_state_survived(m_runtime.uplink.local_interface()))
+        {
+            VLOGI << "VPP state survived the reconnect; skip replay";
+            holdFailedTasks();
+        }
+        else
+        {
+            VLOGD << "Replay the state after reconnecting ...";
+            VOM::OM::replay();
+
+            std::lock_guard<std::mutex> lg(m_failed_mutex);
+            m_failed.clear();
+            m_failed_order.clear();
+            m_retries.clear();
+        }
+        m_replay_all = false;
+        m_untracked_seen = TaskStats::get().untracked_failures();
+        handleConnected();
     }
 
     if (!stopping)
@@ -235,21 +778,51 @@ VppManager::handleHWPollTimer(const boost::system::error_code &ec)
 }
 
 void
-VppManager::handleHWStatsTimer(const boost::system::error_code &ec)
+VppManager::runStats()
 {
-    if (stopping || ec) return;
+    /*
+     * the stats can wait; rendering and VPP's workers can't
+     */
+    if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), STATS_NICE))
+        VLOGW << "Failed to lower the stats thread's priority";
+
+    m_stats_io.run();
+}
 
-    VLOGD << "stats reading";
+void
+VppManager::stopStats()
+{
+    m_stats_work.reset();
+    m_stats_io.stop();
 
-    VOM::HW::read_stats();
+    if (m_stats_thread.joinable()) m_stats_thread.join();
+}
 
-    m_stats_timer.reset(
-        new boost::asio::deadline_timer(m_runtime.agent.getAgentIOService()));
-    m_stats_timer->expires_from_now(boost::posix_time::seconds(5));
+void
+VppManager::armStatsTimer()
+{
+    m_stats_timer.reset(new boost::asio::deadline_timer(m_stats_io));
+    m_stats_timer->expires_from_now(
+        boost::posix_time::seconds(m_runtime.stats.fast_interval()));
     m_stats_timer->async_wait(
         bind(&VppManager::handleHWStatsTimer, this, error));
 }
 
+void
+VppManager::handleHWStatsTimer(const boost::system::error_code &ec)
+{
+    if (stopping || ec) return;
+
+    /*
+     * VOM is locked only to snapshot the interfaces to read; the stat
+     * segment is read, and the counters aggregated and published, after
+     */
+    m_runtime.stats.read(m_runtime.om_mutex);
+    m_epm->publish_counters();
+
+    armStatsTimer();
+}
+
 void
 VppManager::handleBoot()
 {
@@ -281,10 +854,7 @@ VppManager::stop()
     m_runtime.agent.getExtraConfigManager().unregisterListener(this);
     m_runtime.agent.getPolicyManager().unregisterListener(this);
 
-    if (m_stats_timer)
-    {
-        m_stats_timer->cancel();
-    }
+    stopStats();
 
     if (m_sweep_timer)
     {
@@ -296,8 +866,24 @@ VppManager::stop()
         m_poll_timer->cancel();
     }
 
-    m_task_queue.dispatch("close-connection",
-                          bind(&VppManager::handleCloseConnection, this));
+    if (m_ep_batch_timer)
+    {
+        m_ep_batch_timer->cancel();
+    }
+
+    if (m_route_batch_timer)
+    {
+        m_route_batch_timer->cancel();
+    }
+
+    if (m_connect_timer)
+    {
+        m_connect_timer->cancel();
+    }
+
+    queueTask("close-connection",
+              {"connect",
+               bind(&VppManager::handleCloseConnection, this)});
 
     VLOGD << "stop VppManager";
 }
@@ -313,13 +899,112 @@ VppManager::setVirtualRouter(bool virtualRouterEnabled,
     }
 }
 
+void
+VppManager::setEndpointBatch(uint32_t window_ms, uint32_t max_size)
+{
+    m_ep_batch_window = window_ms;
+    m_ep_batch_max = (max_size ? max_size : 1);
+}
+
+void
+VppManager::setRouteBatch(uint32_t window_ms, uint32_t max_size)
+{
+    m_route_batch_window = window_ms;
+    m_route_batch_max = (max_size ? max_size : 1);
+}
+
+void
+VppManager::setBootSweep(uint32_t quiet_ms, uint32_t max_secs)
+{
+    m_sweep_quiet = quiet_ms;
+    m_sweep_max = max_secs;
+}
+
 void
 VppManager::endpointUpdated(const std::string &uuid)
 {
     if (stopping) return;
 
-    m_task_queue.dispatch(uuid,
-                          bind(&EndPointManager::handle_update, m_epm, uuid));
+    if (!m_ep_batch_window)
+    {
+        dispatch("endpoint",
+                 uuid,
+                 bind(&EndPointManager::handle_update, m_epm, uuid));
+        return;
+    }
+
+    bool first, full;
+
+    {
+        std::lock_guard<std::mutex> lg(m_ep_batch_mutex);
+        first = m_ep_batch.empty();
+
+        m_ep_batch.insert(uuid);
+        full = (m_ep_batch.size() >= m_ep_batch_max);
+    }
+
+    /*
+     * dispatched without the lock held, since the task may be run
+     * here and now
+     */
+    if (full)
+    {
+        /*
+         * the batch is full, render it now
+         */
+        dispatch("endpoint-batch",
+                 EP_BATCH_ID,
+                 bind(&VppManager::handleEndpointBatch, this));
+    }
+    else if (first)
+    {
+        /*
+         * first update of a new batch; start the collection window
+         */
+        m_runtime.agent.getAgentIOService().dispatch(
+            bind(&VppManager::armEndpointBatch, this));
+    }
+}
+
+void
+VppManager::armEndpointBatch()
+{
+    if (stopping || m_ep_batch_armed) return;
+
+    m_ep_batch_armed = true;
+    m_ep_batch_timer.reset(
+        new boost::asio::deadline_timer(m_runtime.agent.getAgentIOService()));
+    m_ep_batch_timer->expires_from_now(
+        boost::posix_time::milliseconds(m_ep_batch_window));
+    m_ep_batch_timer->async_wait(
+        bind(&VppManager::handleEndpointBatchTimer, this, error));
+}
+
+void
+VppManager::handleEndpointBatchTimer(const boost::system::error_code &ec)
+{
+    m_ep_batch_armed = false;
+
+    if (stopping || ec) return;
+
+    dispatch("endpoint-batch",
+             EP_BATCH_ID,
+             bind(&VppManager::handleEndpointBatch, this));
+}
+
+void
+VppManager::handleEndpointBatch()
+{
+    std::unordered_set<std::string> batch;
+
+    {
+        std::lock_guard<std::mutex> lg(m_ep_batch_mutex);
+        batch.swap(m_ep_batch);
+    }
+
+    if (stopping || batch.empty()) return;
+
+    m_epm->handle_batch_update(batch);
 }
 
 void
@@ -327,8 +1012,9 @@ VppManager::externalEndpointUpdated(const std::string &uuid)
 {
     if (stopping) return;
 
-    m_task_queue.dispatch(
-        uuid, bind(&EndPointManager::handle_external_update, m_epm, uuid));
+    dispatch("external-endpoint",
+             uuid,
+             bind(&EndPointManager::handle_external_update, m_epm, uuid));
 }
 
 void
@@ -336,8 +1022,9 @@ VppManager::remoteEndpointUpdated(const std::string &uuid)
 {
     if (stopping) return;
 
-    m_task_queue.dispatch(
-        uuid, bind(&EndPointManager::handle_remote_update, m_epm, uuid));
+    dispatch("remote-endpoint",
+             uuid,
+             bind(&EndPointManager::handle_remote_update, m_epm, uuid));
 }
 
 void
@@ -351,9 +1038,24 @@ VppManager::serviceUpdated(const std::string &uuid)
 void
 VppManager::rdConfigUpdated(const opflex::modb::URI &rdURI)
 {
-    m_task_queue.dispatch(
-        rdURI.toString(),
-        bind(&RouteManager::handle_domain_update, m_rdm, rdURI));
+    if (stopping) return;
+
+    dispatch("rd-config",
+             rdURI.toString(),
+             bind(&VppManager::handleRdConfigUpdate, this, rdURI));
+}
+
+void
+VppManager::handleRdConfigUpdate(const opflex::modb::URI &rdURI)
+{
+    if (stopping) return;
+
+    /*
+     * rebuild the groups in the RD on next use
+     */
+    m_epgm->invalidate_groups(rdURI);
+    m_rdm->handle_domain_update(rdURI);
+    extNetsUpdated(rdURI);
 }
 
 void
@@ -361,9 +1063,9 @@ VppManager::egDomainUpdated(const opflex::modb::URI &egURI)
 {
     if (stopping) return;
 
-    m_task_queue.dispatch(
-        egURI.toString(),
-        bind(&EndPointGroupManager::handle_update, m_epgm, egURI));
+    dispatch("endpoint-group",
+             egURI.toString(),
+             bind(&EndPointGroupManager::handle_update, m_epgm, egURI));
 }
 
 void
@@ -372,59 +1074,209 @@ VppManager::domainUpdated(opflex::modb::class_id_t cid,
 {
     if (stopping) return;
 
-    m_task_queue.dispatch(
-        domURI.toString(),
-        bind(&VppManager::handleDomainUpdate, this, cid, domURI));
+    dispatch("domain",
+             domURI.toString(),
+             bind(&VppManager::handleDomainUpdate, this, cid, domURI));
 }
 
 void
 VppManager::secGroupSetUpdated(const EndpointListener::uri_set_t &secGrps)
 {
     if (stopping) return;
-    m_task_queue.dispatch(
-        "setSecGrp:",
-        std::bind(&SecurityGroupManager::handle_set_update, m_sgm, secGrps));
+    dispatch("security-group-set",
+             "setSecGrp:" + SecurityGroupManager::get_id(secGrps),
+             std::bind(&VppManager::handleSecGroupSetUpdate, this, secGrps));
+}
+
+void
+VppManager::handleSecGroupSetUpdate(const EndpointListener::uri_set_t &secGrps)
+{
+    if (stopping) return;
+
+    std::unordered_set<std::string> eps;
+
+    m_sgm->handle_set_update(secGrps, eps);
+
+    /*
+     * the set's rules have changed, and hence the name of its ACLs.
+     * re-render its endpoints to bind them to the new ACLs.
+     */
+    for (auto &uuid : eps)
+        endpointUpdated(uuid);
 }
 
 void
 VppManager::secGroupUpdated(const opflex::modb::URI &uri)
 {
     if (stopping) return;
-    m_task_queue.dispatch(
-        "secGrp:", std::bind(&SecurityGroupManager::handle_update, m_sgm, uri));
+    dispatch("security-group",
+             "secGrp:" + uri.toString(),
+             std::bind(&VppManager::handleSecGroupUpdate, this, uri));
+}
+
+void
+VppManager::handleSecGroupUpdate(const opflex::modb::URI &uri)
+{
+    if (stopping) return;
+
+    std::unordered_set<std::string> eps;
+
+    m_sgm->handle_update(uri, eps);
+
+    for (auto &uuid : eps)
+        endpointUpdated(uuid);
 }
 
 void
 VppManager::contractUpdated(const opflex::modb::URI &contractURI)
 {
     if (stopping) return;
-    m_task_queue.dispatch(
-        contractURI.toString(),
-        bind(&ContractManager::handle_update, m_cm, contractURI));
+    dispatch("contract",
+             contractURI.toString(),
+             bind(&ContractManager::handle_update, m_cm, contractURI));
 }
 
 void
 VppManager::externalInterfaceUpdated(const opflex::modb::URI &uri)
 {
     if (stopping) return;
-    m_task_queue.dispatch(uri.toString(),
-                          bind(&ExtItfManager::handle_update, m_eim, uri));
+    dispatch("external-interface",
+             uri.toString(),
+             bind(&VppManager::handleExternalInterfaceUpdate, this, uri));
+}
+
+void
+VppManager::handleExternalInterfaceUpdate(const opflex::modb::URI &uri)
+{
+    if (stopping) return;
+
+    m_eim->handle_update(uri);
+    extNetsUpdated(uri);
+}
+
+void
+VppManager::extNetsUpdated(const opflex::modb::URI &owner)
+{
+    if (!m_route_batch_window)
+    {
+        /*
+         * already in the owner's task
+         */
+        m_rdm->handle_ext_nets(owner);
+        return;
+    }
+
+    batchRoute(owner, true);
 }
 
 void
 VppManager::localRouteUpdated(const opflex::modb::URI &uri)
 {
     if (stopping) return;
-    m_task_queue.dispatch(uri.toString(),
-                          bind(&RouteManager::handle_route_update, m_rdm, uri));
+
+    if (!m_route_batch_window)
+    {
+        dispatch("route",
+                 uri.toString(),
+                 bind(&RouteManager::handle_route_update, m_rdm, uri));
+        return;
+    }
+
+    batchRoute(uri, false);
+}
+
+void
+VppManager::batchRoute(const opflex::modb::URI &uri, bool ext_nets)
+{
+    bool first, full;
+
+    {
+        std::lock_guard<std::mutex> lg(m_route_batch_mutex);
+        first = (m_route_batch.routes.empty() &&
+                 m_route_batch.ext_nets.empty());
+
+        if (ext_nets)
+            m_route_batch.ext_nets.insert(uri);
+        else
+            m_route_batch.routes.insert(uri);
+
+        full = (m_route_batch.routes.size() + m_route_batch.ext_nets.size() >=
+                m_route_batch_max);
+    }
+
+    /*
+     * dispatched without the lock held, since the task may be run
+     * here and now
+     */
+    if (full)
+    {
+        /*
+         * the batch is full, render it now
+         */
+        dispatch("route-batch",
+                 ROUTE_BATCH_ID,
+                 bind(&VppManager::handleRouteBatch, this));
+    }
+    else if (first)
+    {
+        /*
+         * first update of a new batch; start the collection window
+         */
+        m_runtime.agent.getAgentIOService().dispatch(
+            bind(&VppManager::armRouteBatch, this));
+    }
+}
+
+void
+VppManager::armRouteBatch()
+{
+    if (stopping || m_route_batch_armed) return;
+
+    m_route_batch_armed = true;
+    m_route_batch_timer.reset(
+        new boost::asio::deadline_timer(m_runtime.agent.getAgentIOService()));
+    m_route_batch_timer->expires_from_now(
+        boost::posix_time::milliseconds(m_route_batch_window));
+    m_route_batch_timer->async_wait(
+        bind(&VppManager::handleRouteBatchTimer, this, error));
+}
+
+void
+VppManager::handleRouteBatchTimer(const boost::system::error_code &ec)
+{
+    m_route_batch_armed = false;
+
+    if (stopping || ec) return;
+
+    dispatch("route-batch",
+             ROUTE_BATCH_ID,
+             bind(&VppManager::handleRouteBatch, this));
+}
+
+void
+VppManager::handleRouteBatch()
+{
+    route_batch_t batch;
+
+    {
+        std::lock_guard<std::mutex> lg(m_route_batch_mutex);
+        batch.routes.swap(m_route_batch.routes);
+        batch.ext_nets.swap(m_route_batch.ext_nets);
+    }
+
+    if (stopping || (batch.routes.empty() && batch.ext_nets.empty()))
+        return;
+
+    m_rdm->handle_route_batch(batch.routes, batch.ext_nets);
 }
 
 void
 VppManager::handle_interface_event(std::vector<VOM::interface::event> e)
 {
     if (stopping) return;
-    m_task_queue.dispatch("InterfaceEvent",
-                          bind(&VppManager::handleInterfaceEvent, this, e));
+    dispatch("interface-event",
+             "InterfaceEvent",
+             bind(&VppManager::handleInterfaceEvent, this, e));
 }
 
 void
@@ -460,10 +1312,16 @@ VppManager::handleDomainUpdate(opflex::modb::class_id_t cid,
 
     VLOGD << "Updating domain: " << domURI;
 
+    /*
+     * rebuild the groups built from the domain on next use
+     */
+    m_epgm->invalidate_groups(domURI);
+
     switch (cid)
     {
     case modelgbp::gbp::RoutingDomain::CLASS_ID:
         m_rdm->handle_domain_update(domURI);
+        extNetsUpdated(domURI);
         break;
     case modelgbp::gbp::Subnet::CLASS_ID:
         if (!modelgbp::gbp::Subnet::resolve(m_runtime.agent.getFramework(),
@@ -526,17 +1384,24 @@ VppManager::handleConfigUpdate(const opflex::modb::URI &configURI)
     VLOGD << "Updating platform config " << configURI;
     if (stopping) return;
 
+    /*
+     * dropping the spine proxy releases its VOM objects
+     */
+    std::lock_guard<std::recursive_mutex> lg(m_runtime.om_mutex);
+
     initPlatformConfig();
+    m_runtime.uplink.reset_spine_proxy();
 
     /**
      * Now that we are known to be opflex connected,
      * Scehdule a timer to sweep the state we read when we first connected
-     * to VPP.
+     * to VPP, once the renderer has converged.
      */
-    m_sweep_timer.reset(
-        new boost::asio::deadline_timer(m_runtime.agent.getAgentIOService()));
-    m_sweep_timer->expires_from_now(boost::posix_time::seconds(30));
-    m_sweep_timer->async_wait(bind(&VppManager::handleSweepTimer, this, error));
+    if (!m_boot_swept)
+    {
+        m_sweep_start = std::chrono::steady_clock::now();
+        armSweepTimer();
+    }
 }
 
 void
@@ -551,6 +1416,11 @@ VppManager::uplink()
 {
     return m_runtime.uplink;
 }
+StatsTiers &
+VppManager::statsTiers()
+{
+    return m_runtime.stats;
+}
 CrossConnect &
 VppManager::crossConnect()
 {
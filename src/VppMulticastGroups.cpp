@@ -0,0 +1,183 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <sstream>
+
+#include <vom/igmp_binding.hpp>
+#include <vom/igmp_listen.hpp>
+#include <vom/om.hpp>
+#include <vom/route.hpp>
+
+#include "VppLog.hpp"
+#include "VppMulticastGroups.hpp"
+#include "VppUplink.hpp"
+
+using namespace VOM;
+
+namespace VPP
+{
+MulticastGroups::MulticastGroups(Uplink &uplink)
+    : m_uplink(uplink)
+{
+}
+
+static std::string
+group_om_key(const boost::asio::ip::address &group)
+{
+    return ("mcast-group:" + group.to_string());
+}
+
+static std::string
+tunnel_om_key(const boost::asio::ip::address &src,
+              const boost::asio::ip::address &group,
+              uint32_t vni)
+{
+    std::ostringstream s;
+
+    s << "mcast-tunnel:" << src << ":" << group << ":" << vni;
+    return s.str();
+}
+
+std::shared_ptr<vxlan_tunnel>
+MulticastGroups::join(const std::string &owner,
+                      uint32_t vni,
+                      const std::string &maddr)
+{
+    boost::asio::ip::address src = m_uplink.local_address();
+    boost::asio::ip::address dst =
+        boost::asio::ip::address::from_string(maddr);
+    tunnel_key_t key(src, dst, vni);
+
+    auto it = m_tunnels.find(key);
+
+    if (it == m_tunnels.end())
+    {
+        if (0 == m_groups[dst]++)
+        {
+            const std::string gkey = group_om_key(dst);
+
+            /*
+             * add the mcast group to accept via the uplink and
+             * forward locally.
+             */
+            route::path via_uplink(*m_uplink.local_interface(),
+                                   nh_proto_t::IPV4);
+            route::ip_mroute mroute({dst.to_v4(), 32});
+
+            mroute.add(via_uplink, route::itf_flags_t::ACCEPT);
+            mroute.add({route::path::special_t::LOCAL},
+                       route::itf_flags_t::FORWARD);
+            OM::write(gkey, mroute);
+
+            /*
+             * join the group on the uplink interface
+             */
+            igmp_binding igmp_b(*m_uplink.local_interface());
+            OM::write(gkey, igmp_b);
+
+            igmp_listen igmp_l(igmp_b, dst.to_v4());
+            OM::write(gkey, igmp_l);
+
+            VLOGD << "Joined multicast group " << dst;
+        }
+
+        /*
+         * Add the Vxlan mcast tunnel that will carry the broadcast
+         * and multicast traffic
+         */
+        vxlan_tunnel vt(src,
+                        dst,
+                        vni,
+                        *m_uplink.local_interface(),
+                        vxlan_tunnel::mode_t::GBP_L2);
+        OM::write(tunnel_om_key(src, dst, vni), vt);
+
+        it = m_tunnels.emplace(key, tunnel_t{vt.singular(), {}}).first;
+    }
+
+    it->second.owners.insert(owner);
+    m_owners[owner][key] = false;
+
+    return it->second.tunnel;
+}
+
+void
+MulticastGroups::mark(const std::string &owner)
+{
+    auto it = m_owners.find(owner);
+
+    if (it == m_owners.end()) return;
+
+    for (auto &j : it->second)
+        j.second = true;
+}
+
+void
+MulticastGroups::leave(const std::string &owner)
+{
+    auto it = m_owners.find(owner);
+
+    if (it == m_owners.end()) return;
+
+    for (auto j = it->second.begin(); j != it->second.end();)
+    {
+        if (!j->second)
+        {
+            ++j;
+            continue;
+        }
+
+        const tunnel_key_t &key = j->first;
+        auto t = m_tunnels.find(key);
+
+        if (t != m_tunnels.end())
+        {
+            t->second.owners.erase(owner);
+
+            if (t->second.owners.empty())
+            {
+                const boost::asio::ip::address &dst = std::get<1>(key);
+
+                OM::remove(
+                    tunnel_om_key(std::get<0>(key), dst, std::get<2>(key)));
+                m_tunnels.erase(t);
+
+                if (0 == --m_groups[dst])
+                {
+                    OM::remove(group_om_key(dst));
+                    m_groups.erase(dst);
+                    VLOGD << "Left multicast group " << dst;
+                }
+            }
+        }
+        j = it->second.erase(j);
+    }
+
+    if (it->second.empty()) m_owners.erase(it);
+}
+
+MulticastGroups::sweep::sweep(MulticastGroups &groups, const std::string &owner)
+    : m_groups(groups)
+    , m_owner(owner)
+{
+    m_groups.mark(m_owner);
+}
+
+MulticastGroups::sweep::~sweep()
+{
+    m_groups.leave(m_owner);
+}
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
@@ -8,6 +8,9 @@
  * terms of the Eclipse Public License v1.0 which accompanies this distribution,
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
+
+#include <map>
+
 #include <boost/asio/placeholders.hpp>
 
 #include <opflexagent/logging.h>
@@ -16,6 +19,7 @@
 
 #include "VppLogHandler.hpp"
 #include "VppRenderer.hpp"
+#include "VppTaskStats.hpp"
 
 namespace VPP
 {
@@ -39,7 +43,7 @@ opflexagent::Renderer *
 VppRendererPlugin::create(opflexagent::Agent &agent) const
 {
     IdGenerator *idGen = new IdGenerator();
-    VOM::HW::cmd_q *vppQ = new VOM::HW::cmd_q();
+    VOM::HW::cmd_q *vppQ = new CountingCmdQ();
     VOM::stat_reader *vppSR = new stat_reader();
     VppManager *vppManager = new VppManager(agent, *idGen, vppQ, vppSR);
     return new VppRenderer(agent, *idGen, vppManager);
@@ -124,12 +128,32 @@ VppRenderer::setProperties(const boost::property_tree::ptree &properties)
     static const std::string WIFACE("iface");
     static const std::string WVLAN("vlan");
     static const std::string WIP("ip-address");
+    static const std::string EP_BATCH("endpoint-batch");
+    static const std::string EP_BATCH_WINDOW("window");
+    static const std::string EP_BATCH_MAX("max-size");
+    static const std::string ROUTE_BATCH("route-batch");
+    static const std::string ROUTE_BATCH_WINDOW("window");
+    static const std::string ROUTE_BATCH_MAX("max-size");
+    static const std::string BOOT_SWEEP("boot-sweep");
+    static const std::string BOOT_SWEEP_QUIET("quiet");
+    static const std::string BOOT_SWEEP_MAX("max");
+    static const std::string STATS("stats");
+    static const std::string STATS_FAST("fast-interval");
+    static const std::string STATS_SLOW("slow-interval");
+    static const std::map<std::string, StatsTiers::class_t> STATS_CLASSES = {
+        {"endpoint", StatsTiers::class_t::ENDPOINT},
+        {"uplink", StatsTiers::class_t::UPLINK},
+        {"bvi", StatsTiers::class_t::BVI}};
 
     auto vxlan = properties.get_child_optional(ENCAP_VXLAN);
     auto ivxlan = properties.get_child_optional(ENCAP_IVXLAN);
     auto vlan = properties.get_child_optional(ENCAP_VLAN);
     auto vr = properties.get_child_optional(VIRTUAL_ROUTER);
     auto x_connect = properties.get_child_optional(CROSS_CONNECT);
+    auto ep_batch = properties.get_child_optional(EP_BATCH);
+    auto route_batch = properties.get_child_optional(ROUTE_BATCH);
+    auto boot_sweep = properties.get_child_optional(BOOT_SWEEP);
+    auto stats = properties.get_child_optional(STATS);
 
     if (vlan)
     {
@@ -257,6 +281,50 @@ VppRenderer::setProperties(const boost::property_tree::ptree &properties)
         }
     }
 
+    if (ep_batch)
+    {
+        vppManager->setEndpointBatch(
+            ep_batch.get().get<uint32_t>(EP_BATCH_WINDOW, 10),
+            ep_batch.get().get<uint32_t>(EP_BATCH_MAX, 512));
+    }
+
+    if (route_batch)
+    {
+        vppManager->setRouteBatch(
+            route_batch.get().get<uint32_t>(ROUTE_BATCH_WINDOW, 10),
+            route_batch.get().get<uint32_t>(ROUTE_BATCH_MAX, 1024));
+    }
+
+    if (boot_sweep)
+    {
+        vppManager->setBootSweep(
+            boot_sweep.get().get<uint32_t>(BOOT_SWEEP_QUIET, 5000),
+            boot_sweep.get().get<uint32_t>(BOOT_SWEEP_MAX, 300));
+    }
+
+    if (stats)
+    {
+        vppManager->statsTiers().set_intervals(
+            stats.get().get<uint32_t>(STATS_FAST, 5),
+            stats.get().get<uint32_t>(STATS_SLOW, 60));
+
+        for (auto &c : STATS_CLASSES)
+        {
+            auto name = stats.get().get_optional<std::string>(c.first);
+
+            if (!name) continue;
+
+            boost::optional<StatsTiers::tier_t> tier =
+                StatsTiers::parse(name.get());
+
+            if (tier)
+                vppManager->statsTiers().set_tier(c.second, tier.get());
+            else
+                LOG(opflexagent::ERROR) << "Invalid stats tier for "
+                                        << c.first << ": " << name.get();
+        }
+    }
+
     /*
      * Are we opening an inspection socket?
      */
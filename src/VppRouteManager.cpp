@@ -7,8 +7,12 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <chrono>
+#include <sstream>
+
 #include <boost/optional.hpp>
 
+#include <modelgbp/gbp/ExternalInterface.hpp>
 #include <modelgbp/gbp/L3ExternalDomain.hpp>
 #include <modelgbp/gbp/L3ExternalNetwork.hpp>
 #include <modelgbp/gbp/RemoteRoute.hpp>
@@ -34,10 +38,12 @@
 #include <vom/route.hpp>
 #include <vom/route_domain.hpp>
 #include <vom/sub_interface.hpp>
+#include <vom/vxlan_tunnel.hpp>
 
 #include "VppEndPointGroupManager.hpp"
 #include "VppLog.hpp"
 #include "VppRouteManager.hpp"
+#include "VppTaskStats.hpp"
 
 using namespace VOM;
 
@@ -100,11 +106,9 @@ void
 RouteManager::mk_ext_nets(
     Runtime &runtime,
     route_domain &rd,
-    const opflex::modb::URI &uri,
+    const std::string &key,
     std::shared_ptr<modelgbp::gbp::L3ExternalDomain> ext_dom)
 {
-    const std::string &uuid = uri.toString();
-
     /* To get all the external networks in an external domain */
     std::vector<std::shared_ptr<modelgbp::gbp::L3ExternalNetwork>> ext_nets;
     ext_dom->resolveGbpL3ExternalNetwork(ext_nets);
@@ -129,7 +133,7 @@ RouteManager::mk_ext_nets(
 
         for (std::shared_ptr<modelgbp::gbp::ExternalSubnet> snet : ext_subs)
         {
-            VLOGD << "External-Interface; subnet:" << uri
+            VLOGD << "External-Network; subnet:" << key
                   << " external:" << ext_dom.get()->getName("n/a")
                   << " external-net:" << net->getName("n/a")
                   << " external-sub:" << snet->getAddress("n/a") << "/"
@@ -142,11 +146,68 @@ RouteManager::mk_ext_nets(
                 boost::asio::ip::address::from_string(snet->getAddress().get());
 
             gbp_subnet gs(rd, {addr, snet->getPrefixLen().get()}, sclass.get());
-            OM::write(uuid, gs);
+            OM::write(key, gs);
         }
     }
 }
 
+void
+RouteManager::handle_ext_nets(const opflex::modb::URI &owner)
+{
+    const std::string key = owner.toString() + ":ext-nets";
+
+    OM::mark_n_sweep ms(key);
+
+    std::shared_ptr<modelgbp::gbp::RoutingDomain> opf_rd;
+    std::vector<std::shared_ptr<modelgbp::gbp::L3ExternalDomain>> ext_doms;
+
+    boost::optional<std::shared_ptr<modelgbp::gbp::RoutingDomain>> op_opf_rd =
+        modelgbp::gbp::RoutingDomain::resolve(m_runtime.agent.getFramework(),
+                                              owner);
+
+    if (op_opf_rd)
+    {
+        opf_rd = op_opf_rd.get();
+
+        boost::optional<std::shared_ptr<modelgbp::gbpe::InstContext>> rd_inst =
+            opf_rd->resolveGbpeInstContext();
+
+        if (!rd_inst || !rd_inst.get()->getEncapId()) return;
+
+        opf_rd->resolveGbpL3ExternalDomain(ext_doms);
+    }
+    else if (modelgbp::gbp::ExternalInterface::resolve(
+                 m_runtime.agent.getFramework(), owner))
+    {
+        op_opf_rd = m_runtime.policy_manager().getRDForExternalInterface(owner);
+
+        boost::optional<std::shared_ptr<modelgbp::gbp::L3ExternalDomain>>
+            ext_dom = m_runtime.policy_manager()
+                          .getExternalDomainForExternalInterface(owner);
+
+        if (!op_opf_rd || !ext_dom) return;
+
+        opf_rd = op_opf_rd.get();
+        ext_doms.push_back(ext_dom.get());
+    }
+    else
+    {
+        VLOGD << "Cleaning up external subnets for: " << owner;
+        return;
+    }
+
+    uint32_t rdId = m_runtime.id_gen.get(
+        modelgbp::gbp::RoutingDomain::CLASS_ID, opf_rd->getURI());
+
+    VOM::route_domain rd(rdId);
+    VOM::OM::write(key, rd);
+
+    for (std::shared_ptr<modelgbp::gbp::L3ExternalDomain> ext_dom : ext_doms)
+    {
+        mk_ext_nets(m_runtime, rd, key, ext_dom);
+    }
+}
+
 void
 RouteManager::handle_domain_update(const opflex::modb::URI &uri)
 {
@@ -159,6 +220,7 @@ RouteManager::handle_domain_update(const opflex::modb::URI &uri)
     if (!op_opf_rd)
     {
         VLOGD << "Cleaning up for RD: " << uri;
+        remove_subnets(uri.toString());
         m_runtime.id_gen.erase(modelgbp::gbp::RoutingDomain::CLASS_ID, uri);
         return;
     }
@@ -170,6 +232,7 @@ RouteManager::handle_domain_update(const opflex::modb::URI &uri)
     if (!rd_inst || !rd_inst.get()->getEncapId())
     {
         VLOGI << "RD-inst not resolved for: " << uri;
+        remove_subnets(uri.toString());
         return;
     }
 
@@ -182,7 +245,6 @@ RouteManager::handle_domain_update(const opflex::modb::URI &uri)
      */
     opflexagent::network::subnets_t intSubnets =
         get_rd_subnets(m_runtime.agent, uri);
-    boost::system::error_code ec;
 
     /*
      * create (or at least own) VPP's route-domain object
@@ -198,43 +260,158 @@ RouteManager::handle_domain_update(const opflex::modb::URI &uri)
             m_runtime, rd_uuid, rd, rd_inst.get()->getEncapId().get());
 
     /*
-     * For each internal Subnet
+     * the internal subnets are keyed apart from the RD, so an update
+     * renders only those that changed
+     */
+    update_subnets(
+        rd_uuid, *v_grd, rdId, rd_inst.get()->getEncapId().get(), intSubnets);
+
+    /*
+     * the external subnets are rendered by handle_ext_nets, in the
+     * RD's route batch
      */
-    for (const auto &sn : intSubnets)
+}
+
+/**
+ * The OM key of an internal subnet of an RD
+ */
+static std::string
+subnet_om_key(const std::string &rd_uuid,
+              const std::pair<std::string, uint8_t> &sn)
+{
+    return (rd_uuid + ":subnet:" + sn.first + "/" + std::to_string(sn.second));
+}
+
+void
+RouteManager::update_subnets(const std::string &rd_uuid,
+                             const gbp_route_domain &grd,
+                             uint32_t rd_id,
+                             uint32_t encap,
+                             const opflexagent::network::subnets_t &subnets)
+{
+    auto it = m_rd_subnets.find(rd_uuid);
+    bool all = true;
+
+    if (it == m_rd_subnets.end())
+    {
+        it = m_rd_subnets.emplace(rd_uuid, rd_subnets_t()).first;
+    }
+    else
     {
+        all = (it->second.rd_id != rd_id || it->second.encap != encap ||
+               it->second.transport != m_runtime.is_transport_mode);
+    }
+
+    rd_subnets_t &rs = it->second;
+    std::map<subnet_t, boost::asio::ip::address> rendered;
+    size_t n_added = 0;
+
+    rs.rd_id = rd_id;
+    rs.encap = encap;
+    rs.transport = m_runtime.is_transport_mode;
+
+    for (const auto &sn : subnets)
+    {
+        auto old = rs.subnets.find(sn);
+
+        if (old != rs.subnets.end())
+        {
+            /*
+             * rendered last time; the address is already parsed
+             */
+            auto r = rendered.emplace(sn, old->second).first;
+            rs.subnets.erase(old);
+
+            if (!all) continue;
+
+            /*
+             * the route-domain changed; replace it under its key
+             */
+            OM::mark_n_sweep ms(subnet_om_key(rd_uuid, sn));
+            gbp_subnet gs(grd,
+                          {r->second, sn.second},
+                          (rs.transport
+                               ? gbp_subnet::type_t::TRANSPORT
+                               : gbp_subnet::type_t::STITCHED_INTERNAL));
+            OM::write(subnet_om_key(rd_uuid, sn), gs);
+            continue;
+        }
+
         /*
          * still a little more song and dance before we can get
          * our hands on an address ...
          */
+        boost::system::error_code ec;
         boost::asio::ip::address addr =
             boost::asio::ip::address::from_string(sn.first, ec);
         if (ec) continue;
 
-        VLOGD << "Importing routing domain:" << uri << " subnet:" << addr << "/"
-              << std::to_string(sn.second);
+        VLOGD << "Importing routing domain:" << rd_uuid << " subnet:" << addr
+              << "/" << std::to_string(sn.second);
 
         /*
          * add a route for the subnet in VPP's route-domain via
          * the EPG's uplink, DVR styleee
          */
-        gbp_subnet gs(*v_grd,
+        gbp_subnet gs(grd,
                       {addr, sn.second},
-                      (m_runtime.is_transport_mode
-                           ? gbp_subnet::type_t::TRANSPORT
-                           : gbp_subnet::type_t::STITCHED_INTERNAL));
-        OM::write(rd_uuid, gs);
+                      (rs.transport ? gbp_subnet::type_t::TRANSPORT
+                                    : gbp_subnet::type_t::STITCHED_INTERNAL));
+        OM::write(subnet_om_key(rd_uuid, sn), gs);
+
+        rendered.emplace(sn, addr);
+        n_added++;
     }
 
     /*
-     * for each external subnet
+     * those left were not in this update
      */
-    std::vector<std::shared_ptr<modelgbp::gbp::L3ExternalDomain>> extDoms;
-    opf_rd.get()->resolveGbpL3ExternalDomain(extDoms);
-
-    for (std::shared_ptr<modelgbp::gbp::L3ExternalDomain> ext_dom : extDoms)
+    for (const auto &sn : rs.subnets)
     {
-        mk_ext_nets(m_runtime, rd, uri, ext_dom);
+        VLOGD << "Removing routing domain:" << rd_uuid << " subnet:"
+              << sn.second << "/" << std::to_string(sn.first.second);
+        OM::remove(subnet_om_key(rd_uuid, sn.first));
     }
+
+    VLOGD << "Routing domain:" << rd_uuid << " subnets:" << rendered.size()
+          << " added:" << n_added << " removed:" << rs.subnets.size();
+
+    rs.subnets.swap(rendered);
+}
+
+void
+RouteManager::remove_subnets(const std::string &rd_uuid)
+{
+    auto it = m_rd_subnets.find(rd_uuid);
+
+    if (it == m_rd_subnets.end()) return;
+
+    for (const auto &sn : it->second.subnets)
+        OM::remove(subnet_om_key(rd_uuid, sn.first));
+
+    m_rd_subnets.erase(it);
+}
+
+void
+RouteManager::handle_route_batch(
+    const std::unordered_set<opflex::modb::URI> &uris,
+    const std::unordered_set<opflex::modb::URI> &owners)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto &uri : uris)
+        handle_route_update(uri);
+    for (auto &owner : owners)
+        handle_ext_nets(owner);
+
+    auto took = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    TaskStats::get().rendered(
+        "route-batch", uris.size() + owners.size(), took);
+
+    VLOGD << "route-batch: " << uris.size() << " routes, " << owners.size()
+          << " external subnet owners in " << took.count() << "us";
 }
 
 void
@@ -251,11 +428,10 @@ RouteManager::handle_route_update(const opflex::modb::URI &uri)
     if (!op_local_route)
     {
         VLOGD << "Cleaning up for Route: " << uri;
+        release_tunnels(uuid);
         return;
     }
 
-    mac_address_t GBP_ROUTED_DST_MAC("00:0c:0c:0c:0c:0c");
-
     std::shared_ptr<modelgbp::gbp::RoutingDomain> rd;
     std::shared_ptr<modelgbp::gbpe::InstContext> rd_inst;
     boost::asio::ip::address pfx_addr;
@@ -279,6 +455,7 @@ RouteManager::handle_route_update(const opflex::modb::URI &uri)
     if (!rd || !rd_inst || !rd_inst->getEncapId())
     {
         VLOGI << "RD/RD-inst not resolved for Route: " << uri;
+        release_tunnels(uuid);
         return;
     }
 
@@ -294,28 +471,23 @@ RouteManager::handle_route_update(const opflex::modb::URI &uri)
 
     route::prefix_t pfx(pfx_addr, pfx_len);
     route::ip_route v_route(v_rd, pfx);
+    std::set<tunnel_key_t> tunnels;
 
     for (auto nh : nh_list)
     {
         if (are_nhs_remote)
         {
             /*
-             * route via vxlan-gbp-tunnel
+             * route via vxlan-gbp-tunnel, shared with the other routes
+             * via this next-hop
              */
-            vxlan_tunnel vt(m_runtime.uplink.local_address(),
-                            nh,
-                            rd_inst->getEncapId().get(),
-                            v_rd,
-                            vxlan_tunnel::mode_t::GBP_L3);
-            OM::write(uuid, vt);
+            uint32_t vni = rd_inst->getEncapId().get();
+            std::shared_ptr<vxlan_tunnel> vt =
+                acquire_tunnel(uuid, nh, vni, v_rd);
 
-            neighbour::flags_t f =
-                (neighbour::flags_t::STATIC | neighbour::flags_t::NO_FIB_ENTRY);
-
-            neighbour nbr(vt, nh, GBP_ROUTED_DST_MAC, f);
-            VOM::OM::write(uuid, nbr);
-
-            v_route.add({nh, vt});
+            tunnels.insert(
+                tunnel_key_t(m_runtime.uplink.local_address(), nh, vni));
+            v_route.add({nh, *vt});
         }
         else
         {
@@ -338,6 +510,97 @@ RouteManager::handle_route_update(const opflex::modb::URI &uri)
     {
         VLOGW << "No slcass for: " << uri;
     }
+
+    release_tunnels(uuid, tunnels);
+}
+
+/**
+ * The OM key of the tunnel to a remote next-hop
+ */
+static std::string
+tunnel_om_key(const boost::asio::ip::address &src,
+              const boost::asio::ip::address &dst,
+              uint32_t vni)
+{
+    std::ostringstream s;
+
+    s << "route-tunnel:" << src << ":" << dst << ":" << vni;
+    return s.str();
+}
+
+std::shared_ptr<vxlan_tunnel>
+RouteManager::acquire_tunnel(const std::string &route,
+                             const boost::asio::ip::address &nh,
+                             uint32_t vni,
+                             const route_domain &rd)
+{
+    const boost::asio::ip::address &src = m_runtime.uplink.local_address();
+    tunnel_key_t key(src, nh, vni);
+
+    auto it = m_tunnels.find(key);
+
+    if (it == m_tunnels.end())
+    {
+        mac_address_t GBP_ROUTED_DST_MAC("00:0c:0c:0c:0c:0c");
+        const std::string okey = tunnel_om_key(src, nh, vni);
+
+        vxlan_tunnel vt(src, nh, vni, rd, vxlan_tunnel::mode_t::GBP_L3);
+        OM::write(okey, vt);
+
+        neighbour::flags_t f =
+            (neighbour::flags_t::STATIC | neighbour::flags_t::NO_FIB_ENTRY);
+
+        neighbour nbr(vt, nh, GBP_ROUTED_DST_MAC, f);
+        OM::write(okey, nbr);
+
+        VLOGD << "Created tunnel " << okey;
+
+        it = m_tunnels.emplace(key, tunnel_t{vt.singular(), {}}).first;
+    }
+
+    it->second.routes.insert(route);
+    m_route_tunnels[route].insert(key);
+
+    return it->second.tunnel;
+}
+
+void
+RouteManager::release_tunnels(const std::string &route,
+                              const std::set<tunnel_key_t> &keep)
+{
+    auto rt = m_route_tunnels.find(route);
+
+    if (rt == m_route_tunnels.end()) return;
+
+    for (auto k = rt->second.begin(); k != rt->second.end();)
+    {
+        if (keep.count(*k))
+        {
+            ++k;
+            continue;
+        }
+
+        auto it = m_tunnels.find(*k);
+
+        if (it != m_tunnels.end())
+        {
+            it->second.routes.erase(route);
+
+            if (it->second.routes.empty())
+            {
+                const std::string okey = tunnel_om_key(
+                    std::get<0>(*k), std::get<1>(*k), std::get<2>(*k));
+
+                OM::remove(okey);
+                VLOGD << "Removed tunnel " << okey;
+
+                m_tunnels.erase(it);
+            }
+        }
+        k = rt->second.erase(k);
+    }
+
+    if (rt->second.empty()) m_route_tunnels.erase(rt);
 }
 
 }; // namepsace VPP
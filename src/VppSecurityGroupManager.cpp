@@ -15,9 +15,9 @@
 #include <modelgbp/l2/EtherTypeEnumT.hpp>
 #include <modelgbp/l4/TcpFlagsEnumT.hpp>
 
-#include <vom/acl_binding.hpp>
+#include <iomanip>
 
-#include "VppEndPointManager.hpp"
+#include "VppAclCompiler.hpp"
 #include "VppLog.hpp"
 #include "VppSecurityGroupManager.hpp"
 
@@ -100,6 +100,13 @@ setParamUpdate(modelgbp::gbpe::L24Classifier &cls, ACL::l3_rule &rule)
     }
 }
 
+static void
+merge_origins(const AclRules::origins_t &from, AclRules::origins_t &to)
+{
+    for (auto &o : from)
+        to[o.first].insert(o.second.begin(), o.second.end());
+}
+
 void
 SecurityGroupManager::build_update(
     opflexagent::Agent &agent,
@@ -107,7 +114,9 @@ SecurityGroupManager::build_update(
     const std::string &secGrpId,
     ACL::l3_list::rules_t &in_rules,
     ACL::l3_list::rules_t &out_rules,
-    ACL::acl_ethertype::ethertype_rules_t &ethertype_rules)
+    ACL::acl_ethertype::ethertype_rules_t &ethertype_rules,
+    AclRules::origins_t &in_origins,
+    AclRules::origins_t &out_origins)
 {
     if (secGrps.empty())
     {
@@ -128,6 +137,7 @@ SecurityGroupManager::build_update(
             const std::shared_ptr<modelgbp::gbpe::L24Classifier> &cls =
                 pc->getL24Classifier();
             uint32_t priority = pc->getPriority();
+            const std::string uri = pc->getURI().toString();
             const ethertype_t &etherType =
                 ethertype_t::from_numeric_val(cls->getEtherT(
                     modelgbp::l2::EtherTypeEnumT::CONST_UNSPECIFIED));
@@ -193,6 +203,7 @@ SecurityGroupManager::build_update(
                         ACL::l3_rule rule(priority, act, ip, ip2);
                         setParamUpdate(*cls, rule);
                         out_rules.insert(rule);
+                        out_origins[rule].insert(uri);
                     }
                     if (dir == modelgbp::gbp::DirectionEnumT::
                                    CONST_BIDIRECTIONAL ||
@@ -201,6 +212,7 @@ SecurityGroupManager::build_update(
                         ACL::l3_rule rule(priority, act, ip2, ip);
                         setParamUpdate(*cls, rule);
                         in_rules.insert(rule);
+                        in_origins[rule].insert(uri);
                     }
                 }
             }
@@ -221,11 +233,13 @@ SecurityGroupManager::build_update(
                     dir == modelgbp::gbp::DirectionEnumT::CONST_IN)
                 {
                     out_rules.insert(rule);
+                    out_origins[rule].insert(uri);
                 }
                 if (dir == modelgbp::gbp::DirectionEnumT::CONST_BIDIRECTIONAL ||
                     dir == modelgbp::gbp::DirectionEnumT::CONST_OUT)
                 {
                     in_rules.insert(rule);
+                    in_origins[rule].insert(uri);
                 }
             }
         }
@@ -247,74 +261,147 @@ SecurityGroupManager::get_id(
     return ss.str();
 }
 
-void
-SecurityGroupManager::handle_set_update(
-    const opflexagent::EndpointListener::uri_set_t &secGrps)
+std::string
+SecurityGroupManager::get_acl_name(const ACL::l3_list::rules_t &rules)
 {
-    VLOGD << "Updating security group set";
+    /*
+     * rules are ordered by priority only, and those of equal priority
+     * as they were added, so the digest is of the rules in any order.
+     * It's 128 bits, of two independent hashes of each rule, so the
+     * name is a function of the rules alone.
+     */
+    std::hash<std::string> string_hash;
+    uint64_t digest[2] = {0, 0};
+
+    for (auto &rule : rules)
+    {
+        const std::string r = rule.to_string();
+        uint64_t h[2] = {string_hash(r), string_hash(r + "/sg")};
 
-    ACL::l3_list::rules_t in_rules, out_rules;
-    ACL::acl_ethertype::ethertype_rules_t ethertype_rules;
-    const std::string secGrpId = get_id(secGrps);
-    std::shared_ptr<ACL::l3_list> in_acl, out_acl;
+        for (int i = 0; i < 2; i++)
+            digest[i] += (h[i] ^ (h[i] >> 31)) * 0x9e3779b97f4a7c15ULL;
+    }
+
+    std::ostringstream s;
+    s << "sg-" << std::hex << std::setfill('0') << std::setw(16) << digest[0]
+      << std::setw(16) << digest[1] << "-" << std::dec << rules.size();
+
+    const std::string name = s.str();
 
-    build_update(
-        m_agent, secGrps, secGrpId, in_rules, out_rules, ethertype_rules);
+    /*
+     * an ACL of that name with other rules would be rewritten, for
+     * every interface that shares it
+     */
+    std::shared_ptr<ACL::l3_list> acl = ACL::l3_list::find(name);
 
-    if (in_rules.empty() && out_rules.empty() && ethertype_rules.empty())
+    if (acl && !(*acl == ACL::l3_list(name, rules)))
+        VLOGE << "ACL digest collision; " << name
+              << " is rewritten with other rules";
+
+    return name;
+}
+
+void
+SecurityGroupManager::get_rules(
+    const std::string &owner,
+    const opflexagent::EndpointListener::uri_set_t &secGrps,
+    ACL::l3_list::rules_t &in_rules,
+    ACL::l3_list::rules_t &out_rules,
+    ACL::acl_ethertype::ethertype_rules_t &ethertype_rules,
+    AclRules::origins_t &in_origins,
+    AclRules::origins_t &out_origins)
+{
+    if (secGrps.empty())
     {
-        VLOGW << "in and out rules are empty";
+        release(owner);
         return;
     }
 
-    opflexagent::EndpointManager &epMgr = m_agent.getEndpointManager();
-    std::unordered_set<std::string> eps;
-    epMgr.getEndpointsForSecGrps(secGrps, eps);
+    const std::string secGrpId = get_id(secGrps);
+
+    /*
+     * an owner that stays in its set keeps the set's rules cached; one
+     * that moves releases its last
+     */
+    auto os = m_owner_set.find(owner);
+
+    if (os != m_owner_set.end() && os->second != secGrpId) release(owner);
+
+    auto it = m_set_rules.find(secGrpId);
 
-    for (const std::string &uuid : eps)
+    if (it == m_set_rules.end())
     {
-        OM::mark_n_sweep ms(uuid);
+        set_rules_t sr;
 
-        const opflexagent::Endpoint &endPoint = *epMgr.getEndpoint(uuid).get();
-        const std::string vppInterfaceName =
-            EndPointManager::get_ep_interface_name(endPoint);
+        build_update(m_agent,
+                     secGrps,
+                     secGrpId,
+                     sr.in_rules,
+                     sr.out_rules,
+                     sr.ethertype_rules,
+                     sr.in_origins,
+                     sr.out_origins);
 
-        if (0 == vppInterfaceName.length()) continue;
+        size_t n_rules = sr.in_rules.size() + sr.out_rules.size();
 
-        std::shared_ptr<interface> itf = interface::find(vppInterfaceName);
+        sr.in_rules = AclCompiler::compile(sr.in_rules);
+        sr.out_rules = AclCompiler::compile(sr.out_rules);
 
-        if (!itf) continue;
+        VLOGD << "Compiled security group set " << secGrpId << " from "
+              << n_rules << " to "
+              << sr.in_rules.size() + sr.out_rules.size() << " rules";
 
-        if (!ethertype_rules.empty())
-        {
-            ACL::acl_ethertype a_e(*itf, ethertype_rules);
-            OM::write(uuid, a_e);
-        }
-        if (!in_rules.empty())
-        {
-            ACL::l3_list inAcl(secGrpId + "in", in_rules);
-            OM::write(uuid, inAcl);
+        it = m_set_rules.emplace(secGrpId, std::move(sr)).first;
+    }
 
-            ACL::l3_binding in_binding(direction_t::INPUT, *itf, inAcl);
-            OM::write(uuid, in_binding);
-        }
-        if (!out_rules.empty())
-        {
-            ACL::l3_list outAcl(secGrpId + "out", out_rules);
-            OM::write(uuid, outAcl);
-            ACL::l3_binding out_binding(direction_t::OUTPUT, *itf, outAcl);
-            OM::write(uuid, out_binding);
-        }
+    it->second.owners.insert(owner);
+    m_owner_set[owner] = secGrpId;
+
+    in_rules.insert(it->second.in_rules.begin(), it->second.in_rules.end());
+    out_rules.insert(it->second.out_rules.begin(), it->second.out_rules.end());
+    ethertype_rules.insert(it->second.ethertype_rules.begin(),
+                           it->second.ethertype_rules.end());
+    merge_origins(it->second.in_origins, in_origins);
+    merge_origins(it->second.out_origins, out_origins);
+}
+
+void
+SecurityGroupManager::release(const std::string &owner)
+{
+    auto it = m_owner_set.find(owner);
+
+    if (it == m_owner_set.end()) return;
+
+    auto sr = m_set_rules.find(it->second);
+
+    if (sr != m_set_rules.end())
+    {
+        sr->second.owners.erase(owner);
+        if (sr->second.owners.empty()) m_set_rules.erase(sr);
     }
+    m_owner_set.erase(it);
+}
+
+void
+SecurityGroupManager::handle_set_update(
+    const opflexagent::EndpointListener::uri_set_t &secGrps,
+    std::unordered_set<std::string> &eps)
+{
+    VLOGD << "Updating security group set";
+
+    m_set_rules.erase(get_id(secGrps));
+
+    m_agent.getEndpointManager().getEndpointsForSecGrps(secGrps, eps);
 }
 
 void
-SecurityGroupManager::handle_update(const opflex::modb::URI &uri)
+SecurityGroupManager::handle_update(const opflex::modb::URI &uri,
+                                    std::unordered_set<std::string> &eps)
 {
     std::unordered_set<opflexagent::EndpointListener::uri_set_t> secGrpSets;
     m_agent.getEndpointManager().getSecGrpSetsForSecGrp(uri, secGrpSets);
     for (auto &secGrpSet : secGrpSets)
-        handle_set_update(secGrpSet);
+        handle_set_update(secGrpSet, eps);
 }
 
 }; // namepsace VPP
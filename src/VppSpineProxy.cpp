@@ -51,8 +51,11 @@ SpineProxy::mk_intf(const std::string &key,
                     boost::asio::ip::address_v4 &dst,
                     uint32_t vnid)
 {
-    std::shared_ptr<VOM::vxlan_tunnel> vt = std::make_shared<vxlan_tunnel>(
-        src, dst, vnid, vxlan_tunnel::mode_t::GBP_L2);
+    std::shared_ptr<VOM::vxlan_tunnel> &vt = m_tunnels[{dst, vnid}];
+
+    if (!vt)
+        vt = std::make_shared<vxlan_tunnel>(
+            src, dst, vnid, vxlan_tunnel::mode_t::GBP_L2);
     OM::write(key, *vt);
 
     return vt;
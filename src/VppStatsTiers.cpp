@@ -0,0 +1,239 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <vom/hw.hpp>
+
+#include "VppInterfaceRates.hpp"
+#include "VppLog.hpp"
+#include "VppStatsTiers.hpp"
+
+namespace VPP
+{
+StatsTiers::StatsTiers()
+    : m_tiers({{class_t::ENDPOINT, tier_t::FAST},
+               {class_t::UPLINK, tier_t::SLOW},
+               {class_t::BVI, tier_t::OFF}})
+    , m_fast_secs(5)
+    , m_slow_secs(60)
+{
+}
+
+boost::optional<StatsTiers::tier_t>
+StatsTiers::parse(const std::string &name)
+{
+    if ("fast" == name) return tier_t::FAST;
+    if ("slow" == name) return tier_t::SLOW;
+    if ("off" == name) return tier_t::OFF;
+
+    return boost::none;
+}
+
+void
+StatsTiers::set_intervals(uint32_t fast_secs, uint32_t slow_secs)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    m_fast_secs = std::max(fast_secs, 1u);
+    m_slow_secs = std::max(slow_secs, m_fast_secs);
+}
+
+void
+StatsTiers::set_tier(class_t cls, tier_t tier)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    m_tiers[cls] = tier;
+}
+
+uint32_t
+StatsTiers::fast_interval() const
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    return m_fast_secs;
+}
+
+void
+StatsTiers::add(const std::shared_ptr<VOM::interface> &itf,
+                class_t cls,
+                VOM::interface::stat_listener *listener)
+{
+    if (!itf) return;
+
+    std::lock_guard<std::mutex> lg(m_mutex);
+    itf_t entry = {itf, (listener ? listener : this), itf->handle().value()};
+
+    if (!listener) m_own[itf->name()] = entry;
+
+    /*
+     * the stats are enabled at the next read, as VOM's set of the
+     * interfaces to read must not change while it reads them
+     */
+    switch (m_tiers[cls])
+    {
+    case tier_t::FAST:
+        m_adding.push_back(entry);
+        break;
+    case tier_t::SLOW:
+        /*
+         * VOM reads the stats of all the enabled interfaces at once, so
+         * those of the slow tier are enabled only for the reads it's due
+         */
+        m_slow[itf->name()] = entry;
+        break;
+    case tier_t::OFF:
+        break;
+    }
+}
+
+void
+StatsTiers::read(std::recursive_mutex &om_mutex)
+{
+    std::vector<std::shared_ptr<VOM::interface>> reading;
+    std::vector<std::shared_ptr<VOM::interface>> slow;
+
+    {
+        std::lock_guard<std::recursive_mutex> olg(om_mutex);
+        std::lock_guard<std::mutex> lg(m_mutex);
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto &a : m_adding)
+        {
+            std::shared_ptr<VOM::interface> itf = a.itf.lock();
+
+            if (!itf) continue;
+
+            itf->enable_stats(a.listener);
+            m_enabled.insert(itf);
+        }
+        m_adding.clear();
+
+        /*
+         * hold the interfaces whose stats are enabled, so none is
+         * destroyed, and its stats disabled, while they are read
+         */
+        for (auto it = m_enabled.begin(); it != m_enabled.end();)
+        {
+            std::shared_ptr<VOM::interface> itf = it->lock();
+
+            if (!itf)
+            {
+                it = m_enabled.erase(it);
+                continue;
+            }
+            reading.push_back(itf);
+            ++it;
+        }
+
+        bool slow_due =
+            (now - m_slow_last >= std::chrono::seconds(m_slow_secs));
+
+        if (slow_due) m_slow_last = now;
+
+        for (auto it = m_slow.begin(); it != m_slow.end();)
+        {
+            std::shared_ptr<VOM::interface> itf = it->second.itf.lock();
+
+            if (!itf)
+            {
+                it = m_slow.erase(it);
+                continue;
+            }
+            if (slow_due)
+            {
+                itf->enable_stats(this);
+                slow.push_back(itf);
+            }
+            ++it;
+        }
+    }
+
+    /*
+     * the stat segment is read without VOM locked, so rendering is not
+     * held up by this, lower priority, thread. The stats are passed to
+     * the listeners as they are read, so the tiers are not locked
+     * either.
+     */
+    if (!reading.empty() || !slow.empty())
+    {
+        VLOGD << "stats reading; interfaces:" << reading.size()
+              << " slow:" << slow.size();
+        VOM::HW::read_stats();
+    }
+
+    {
+        /*
+         * forget the rates of the interfaces that are gone
+         */
+        std::lock_guard<std::mutex> lg(m_mutex);
+
+        for (auto it = m_own.begin(); it != m_own.end();)
+        {
+            if (it->second.itf.expired())
+            {
+                InterfaceRates::get().remove(it->second.handle);
+                it = m_own.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    /*
+     * the last reference to an interface removed meanwhile may be this
+     * one, and its removal writes to VOM
+     */
+    std::lock_guard<std::recursive_mutex> olg(om_mutex);
+
+    for (auto &itf : slow)
+        itf->disable_stats();
+    slow.clear();
+    reading.clear();
+}
+
+void
+StatsTiers::handle_interface_stat(const VOM::interface &itf)
+{
+    VOM::interface::stat_listener *listener = this;
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        auto it = m_slow.find(itf.name());
+
+        if (it != m_slow.end()) listener = it->second.listener;
+    }
+
+    if (listener != this)
+    {
+        listener->handle_interface_stat(itf);
+        return;
+    }
+
+    auto &data = itf.get_stats();
+
+    InterfaceRates::get().update(itf.handle().value(),
+                                 itf.name(),
+                                 {},
+                                 {std::chrono::steady_clock::now(),
+                                  InterfaceRates::sanitize(data.m_rx.packets),
+                                  InterfaceRates::sanitize(data.m_tx.packets),
+                                  InterfaceRates::sanitize(data.m_rx.bytes),
+                                  InterfaceRates::sanitize(data.m_tx.bytes),
+                                  InterfaceRates::drops_t::from(data)});
+}
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
@@ -0,0 +1,278 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <algorithm>
+#include <iomanip>
+
+#include "VppTaskStats.hpp"
+
+namespace VPP
+{
+Histogram::Histogram()
+    : m_buckets()
+    , m_count(0)
+    , m_sum(0)
+    , m_max(0)
+{
+}
+
+uint32_t
+Histogram::index(uint64_t value)
+{
+    if (value < SUB_BUCKETS) return value;
+
+    uint32_t msb = 63 - __builtin_clzll(value);
+
+    if (msb >= MAX_BITS) return (N_BUCKETS - 1);
+
+    uint32_t shift = msb - SUB_BITS;
+
+    return ((shift + 1) * SUB_BUCKETS +
+            ((value >> shift) & (SUB_BUCKETS - 1)));
+}
+
+uint64_t
+Histogram::value(uint32_t index)
+{
+    if (index < SUB_BUCKETS) return index;
+
+    uint32_t shift = index / SUB_BUCKETS - 1;
+
+    return ((uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift);
+}
+
+void
+Histogram::record(uint64_t value)
+{
+    m_buckets[index(value)]++;
+    m_count++;
+    m_sum += value;
+    if (value > m_max) m_max = value;
+}
+
+uint64_t
+Histogram::count() const
+{
+    return m_count;
+}
+
+uint64_t
+Histogram::max() const
+{
+    return m_max;
+}
+
+uint64_t
+Histogram::mean() const
+{
+    return (m_count ? m_sum / m_count : 0);
+}
+
+uint64_t
+Histogram::percentile(double pct) const
+{
+    uint64_t target = (pct * m_count + 99) / 100;
+    uint64_t seen = 0;
+
+    if (!target) return 0;
+
+    for (uint32_t ii = 0; ii < N_BUCKETS; ii++)
+    {
+        seen += m_buckets[ii];
+        if (seen >= target) return std::min(value(ii), m_max);
+    }
+    return m_max;
+}
+
+/**
+ * Whether this thread is running a task, and the number of commands it
+ * sent and of its writes that failed. Counted per thread so that those
+ * of other threads, e.g. the stats, are not credited to the task.
+ */
+static thread_local bool t_in_task = false;
+static thread_local uint64_t t_cmds = 0;
+static thread_local uint64_t t_failed = 0;
+
+TaskStats::TaskStats()
+    : m_depth(0)
+    , m_depth_max(0)
+    , m_boot_stale(0)
+    , m_cmds(0)
+    , m_failed(0)
+    , m_untracked(0)
+{
+    VOM::inspect::register_handler({"tasks"}, "Renderer task stats", this);
+}
+
+TaskStats &
+TaskStats::get()
+{
+    static TaskStats instance;
+
+    return instance;
+}
+
+bool
+TaskStats::run(const std::string &type,
+               const std::chrono::steady_clock::time_point &queued,
+               const std::function<void()> &func)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint64_t cmds = t_cmds;
+    uint64_t failed = t_failed;
+    bool in_task = t_in_task;
+
+    /*
+     * a task run in place by another is credited to both
+     */
+    t_in_task = true;
+    func();
+    t_in_task = in_task;
+
+    auto end = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lg(m_mutex);
+    task_stats_t &ts = m_tasks[type];
+
+    ts.queue.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                        start - queued)
+                        .count());
+    ts.exec.record(
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+            .count());
+    ts.cmds.record(t_cmds - cmds);
+
+    return (t_failed != failed);
+}
+
+void
+TaskStats::queued(size_t depth)
+{
+    m_depth = depth;
+
+    size_t max = m_depth_max;
+    while (depth > max && !m_depth_max.compare_exchange_weak(max, depth))
+        ;
+}
+
+void
+TaskStats::boot_stale(size_t remaining)
+{
+    m_boot_stale = remaining;
+}
+
+void
+TaskStats::issued(size_t n_cmds)
+{
+    m_cmds += n_cmds;
+    t_cmds += n_cmds;
+}
+
+void
+TaskStats::failed()
+{
+    m_failed++;
+
+    if (t_in_task)
+        t_failed++;
+    else
+        m_untracked++;
+}
+
+uint64_t
+TaskStats::untracked_failures() const
+{
+    return m_untracked;
+}
+
+void
+TaskStats::rendered(const std::string &type,
+                    size_t n_items,
+                    std::chrono::microseconds took)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+    task_stats_t &ts = m_tasks[type];
+
+    ts.items.record(n_items);
+    ts.rate.record(n_items * 1000000 / std::max<int64_t>(took.count(), 1));
+}
+
+static void
+show_histogram(std::ostream &os, const std::string &name, const Histogram &h)
+{
+    os << "  " << std::left << std::setw(6) << name << std::right
+       << " mean:" << std::setw(8) << h.mean() << " p50:" << std::setw(8)
+       << h.percentile(50) << " p90:" << std::setw(8) << h.percentile(90)
+       << " p99:" << std::setw(8) << h.percentile(99) << " max:"
+       << std::setw(8) << h.max() << std::endl;
+}
+
+void
+TaskStats::show(std::ostream &os)
+{
+    std::lock_guard<std::mutex> lg(m_mutex);
+
+    os << "queue-depth:" << m_depth << " high-watermark:" << m_depth_max
+       << " vpp-commands:" << m_cmds << " failed-writes:" << m_failed
+       << std::endl;
+    os << "boot-sweep remaining-interfaces:" << m_boot_stale << std::endl;
+    os << "[queue/exec in us]" << std::endl;
+
+    for (auto &t : m_tasks)
+    {
+        os << t.first << " count:" << t.second.exec.count() << std::endl;
+        show_histogram(os, "queue", t.second.queue);
+        show_histogram(os, "exec", t.second.exec);
+        show_histogram(os, "cmds", t.second.cmds);
+        if (t.second.items.count())
+        {
+            show_histogram(os, "items", t.second.items);
+            show_histogram(os, "rate", t.second.rate);
+        }
+    }
+}
+
+void
+CountingCmdQ::enqueue(VOM::cmd *c)
+{
+    TaskStats::get().issued(1);
+    VOM::HW::cmd_q::enqueue(c);
+}
+
+void
+CountingCmdQ::enqueue(std::shared_ptr<VOM::cmd> c)
+{
+    TaskStats::get().issued(1);
+    VOM::HW::cmd_q::enqueue(c);
+}
+
+void
+CountingCmdQ::enqueue(std::queue<VOM::cmd *> &c)
+{
+    TaskStats::get().issued(c.size());
+    VOM::HW::cmd_q::enqueue(c);
+}
+
+VOM::rc_t
+CountingCmdQ::write()
+{
+    VOM::rc_t rc = VOM::HW::cmd_q::write();
+
+    if (VOM::rc_t::OK != rc) TaskStats::get().failed();
+
+    return rc;
+}
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
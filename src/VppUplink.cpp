@@ -34,9 +34,11 @@ namespace VPP
 
 static const std::string UPLINK_KEY = "__uplink__";
 
-Uplink::Uplink(opflexagent::Agent &agent)
+Uplink::Uplink(opflexagent::Agent &agent, std::recursive_mutex &om_mutex)
     : m_type(VLAN)
     , m_agent(agent)
+    , m_om_mutex(om_mutex)
+    , m_generation(0)
 {
 }
 
@@ -125,6 +127,11 @@ Uplink::handle_dhcp_event_i(std::shared_ptr<dhcp_client::lease_t> lease)
 {
     LOG(opflexagent::INFO) << "DHCP Event: " << lease->to_string();
 
+    /*
+     * the tasks read the prefix, and write to the OM, under this lock
+     */
+    std::lock_guard<std::recursive_mutex> lg(m_om_mutex);
+
     m_pfx = lease->host_prefix;
 
     /*
@@ -137,6 +144,11 @@ Uplink::handle_dhcp_event_i(std::shared_ptr<dhcp_client::lease_t> lease)
      * VXLAN tunnels use the DHCP address as the source
      */
     m_vxlan.src = m_pfx.address();
+
+    /*
+     * the spine proxy's tunnels are sourced from the DHCP address
+     */
+    reset_spine_proxy();
 }
 
 std::shared_ptr<SpineProxy>
@@ -148,20 +160,41 @@ Uplink::spine_proxy()
         break;
     case opflex::ofcore::OFConstants::TRANSPORT_MODE:
     {
-        boost::asio::ip::address_v4 v4, v6, mac;
+        std::lock_guard<std::mutex> lg(m_spine_proxy_mutex);
+
+        if (!m_spine_proxy)
+        {
+            boost::asio::ip::address_v4 v4, v6, mac;
 
-        m_agent.getV4Proxy(v4);
-        m_agent.getV6Proxy(v6);
-        m_agent.getMacProxy(mac);
+            m_agent.getV4Proxy(v4);
+            m_agent.getV6Proxy(v6);
+            m_agent.getMacProxy(mac);
 
-        return std::make_shared<SpineProxy>(
-            local_address().to_v4(), v4, v6, mac);
+            m_spine_proxy = std::make_shared<SpineProxy>(
+                local_address().to_v4(), v4, v6, mac);
+        }
+        return m_spine_proxy;
         break;
     }
     }
     return {};
 }
 
+void
+Uplink::reset_spine_proxy()
+{
+    std::lock_guard<std::mutex> lg(m_spine_proxy_mutex);
+
+    m_spine_proxy.reset();
+    m_generation++;
+}
+
+uint32_t
+Uplink::generation() const
+{
+    return m_generation;
+}
+
 const boost::asio::ip::address &
 Uplink::local_address() const
 {
@@ -282,6 +315,7 @@ Uplink::configure(const std::string &fqdn)
         configure_tap(lease->host_prefix);
         m_vxlan.src = lease->host_prefix.address();
         m_pfx = lease->host_prefix;
+        reset_spine_proxy();
     }
     else
     {
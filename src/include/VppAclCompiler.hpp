@@ -0,0 +1,58 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef __VPP_ACL_COMPILER_H__
+#define __VPP_ACL_COMPILER_H__
+
+#include <vom/acl_l3_list.hpp>
+
+using namespace VOM;
+
+namespace VPP
+{
+/**
+ * Compiles the rules of an L3 ACL into an equivalent, and usually
+ * smaller, set. The rules are evaluated in priority order with the first
+ * match winning, so the compiled set gives the same action for every
+ * packet as the original. The compiler:
+ *  - drops rules shadowed by a rule evaluated before them
+ *  - merges rules whose port ranges overlap or are adjacent
+ *  - merges rules whose remote prefixes are siblings into their parent
+ * A merge is only made when no rule with a different action, evaluated
+ * between the two, overlaps the rule that is moved up.
+ */
+class AclCompiler
+{
+  public:
+    static ACL::l3_list::rules_t compile(const ACL::l3_list::rules_t &rules);
+
+    /**
+     * Does the prefix 'a' contain the prefix 'b'
+     */
+    static bool contains(const route::prefix_t &a, const route::prefix_t &b);
+
+    /**
+     * Does rule 'a' match all the packets rule 'b' matches
+     */
+    static bool covers(const ACL::l3_rule &a, const ACL::l3_rule &b);
+
+    /**
+     * Is there a packet that both rules match
+     */
+    static bool intersects(const ACL::l3_rule &a, const ACL::l3_rule &b);
+};
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
+
+#endif
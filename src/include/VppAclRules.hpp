@@ -0,0 +1,140 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef __VPP_ACL_RULES_H__
+#define __VPP_ACL_RULES_H__
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <vom/acl_l3_list.hpp>
+#include <vom/inspect.hpp>
+
+namespace VPP
+{
+/**
+ * The opflex rules that each rule of the rendered L3 ACLs was built
+ * from. A rule of an ACL is known by its index, which is its position
+ * in the ACL's rules, as VPP numbers them. Shown by the 'acl-rules'
+ * inspect command, so the rules that can never match may be pruned.
+ */
+class AclRules : public VOM::inspect::command_handler
+{
+  public:
+    /**
+     * Orders rules by all their fields. An l3_rule is ordered by its
+     * priority alone, and the rules built from, say, each remote subnet
+     * of a classifier share one.
+     */
+    struct rule_less
+    {
+        bool operator()(const VOM::ACL::l3_rule &a,
+                        const VOM::ACL::l3_rule &b) const;
+    };
+
+    /**
+     * The URIs of the opflex rules each ACL rule was built from
+     */
+    typedef std::map<VOM::ACL::l3_rule, std::set<std::string>, rule_less>
+        origins_t;
+
+    /**
+     * The instance the renderer reports to, registered with inspect
+     */
+    static AclRules &get();
+
+    /**
+     * Add an ACL, rendered by the owner, with the origins of the rules
+     * it was built from. The rules may since have been compiled; each
+     * built rule is attributed to the first rule of the ACL that covers
+     * it. If that rule's action differs, the built rule is shadowed and
+     * can never match. The origins are kept per owner, replacing those
+     * the owner gave before; an ACL shared by owners has the union.
+     */
+    void add(const std::string &owner,
+             const std::string &acl,
+             const VOM::ACL::l3_list::rules_t &rules,
+             const origins_t &origins);
+
+    /**
+     * Remove the owner's ACLs, and the origins it gave; those no other
+     * owner renders are forgotten.
+     */
+    void remove(const std::string &owner);
+
+    /**
+     * The URIs of the opflex rules an ACL's rule was built from
+     */
+    std::set<std::string> uris(const std::string &acl, uint32_t index) const;
+
+    /**
+     * The URIs of the opflex rules that are shadowed in an ACL
+     */
+    std::set<std::string> shadowed(const std::string &acl) const;
+
+    /**
+     * Show the rules, from inspect
+     */
+    void show(std::ostream &os);
+
+  private:
+    /**
+     * A rule of an ACL, and the URIs it was built from, by owner
+     */
+    struct rule_t
+    {
+        std::string desc;
+        std::map<std::string, std::set<std::string>> uris;
+    };
+
+    /**
+     * An ACL and the owners that render it, with the URIs of the rules
+     * each found shadowed
+     */
+    struct acl_t
+    {
+        std::set<std::string> owners;
+        std::vector<rule_t> rules;
+        std::map<std::string, std::set<std::string>> shadowed;
+    };
+
+    /**
+     * The union of the URIs of all owners
+     */
+    static std::set<std::string> merge(
+        const std::map<std::string, std::set<std::string>> &uris);
+
+    /**
+     * Mutex protecting the ACLs; written by rendering, read by inspect
+     */
+    mutable std::mutex m_mutex;
+
+    /**
+     * The ACLs, by name
+     */
+    std::map<std::string, acl_t> m_acls;
+
+    /**
+     * The ACLs each owner renders
+     */
+    std::map<std::string, std::set<std::string>> m_owners;
+};
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
+
+#endif
@@ -10,11 +10,20 @@
 #ifndef __VPP_CONTRACT_MANAGER_H__
 #define __VPP_CONTRACT_MANAGER_H__
 
+#include <set>
+#include <string>
+#include <unordered_map>
+
 #include <opflexagent/Agent.h>
+#include <opflexagent/PolicyManager.h>
 
+#include "VppAclRules.hpp"
+#include "VppContractPairs.hpp"
 #include "VppIdGen.hpp"
 
+#include <vom/acl_l3_list.hpp>
 #include <vom/acl_l3_rule.hpp>
+#include <vom/gbp_contract.hpp>
 
 namespace VPP
 {
@@ -26,11 +35,64 @@ class ContractManager
     void handle_update(const opflex::modb::URI &uri);
 
   private:
+    /**
+     * The state rendered for a contract
+     */
+    struct contract_t
+    {
+        /**
+         * The rules the state was built from
+         */
+        opflexagent::PolicyManager::rule_list_t rules;
+        /**
+         * Do any rules redirect
+         */
+        bool has_redirect;
+        VOM::ACL::l3_list::rules_t in_rules;
+        VOM::ACL::l3_list::rules_t out_rules;
+        AclRules::origins_t in_origins;
+        AclRules::origins_t out_origins;
+        VOM::gbp_contract::gbp_rules_t gbp_rules;
+        VOM::gbp_contract::ethertype_set_t in_ethertypes;
+        VOM::gbp_contract::ethertype_set_t out_ethertypes;
+        /**
+         * The redirect rules with no next-hops
+         */
+        std::set<std::string> blackholes;
+        /**
+         * The provider and consumer pairs rendered
+         */
+        std::set<ContractPairs::sclass_pair_t> pairs;
+    };
+
+    /**
+     * Build the ACL and GBP rules from the contract's rules
+     */
+    void build_rules(const opflex::modb::URI &uri, contract_t &c);
+
+    /**
+     * Write the gbp_contracts of a provider and consumer pair, under
+     * the pair's own key
+     */
+    void write_pair(const std::string &uuid,
+                    const contract_t &c,
+                    const ContractPairs::sclass_pair_t &pair);
+
+    /**
+     * Remove all the state of a contract
+     */
+    void remove(const std::string &uuid);
+
     /**
      * Referene to the uber-agent
      */
     opflexagent::Agent &m_agent;
     IdGen &m_id_gen;
+
+    /**
+     * The state rendered for each contract, by URI
+     */
+    std::unordered_map<std::string, contract_t> m_contracts;
 };
 
 extern void setParamUpdate(modelgbp::gbpe::L24Classifier &cls,
@@ -0,0 +1,99 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef __VPP_CONTRACT_PAIRS_H__
+#define __VPP_CONTRACT_PAIRS_H__
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <vom/inspect.hpp>
+
+namespace VPP
+{
+/**
+ * The pairs of sclasses that each contract is rendered for, and the
+ * redirect rules of each pair that have no next-hops, whose traffic is
+ * not redirected. Shown by the 'contract-pairs' inspect command.
+ */
+class ContractPairs : public VOM::inspect::command_handler
+{
+  public:
+    /**
+     * The source and destination sclass
+     */
+    typedef std::pair<uint32_t, uint32_t> sclass_pair_t;
+
+    /**
+     * The instance the renderer reports to, registered with inspect
+     */
+    static ContractPairs &get();
+
+    /**
+     * Add a pair a contract is rendered for
+     *
+     * @param blackholes the URIs of the contract's redirect rules that
+     * have no next-hops
+     */
+    void add(const std::string &contract,
+             const sclass_pair_t &pair,
+             const std::set<std::string> &blackholes);
+
+    /**
+     * Remove the pairs of a contract; those no other contract is
+     * rendered for are forgotten.
+     */
+    void remove(const std::string &contract);
+
+    /**
+     * Remove a pair of a contract; forgotten if no other contract is
+     * rendered for it.
+     */
+    void remove(const std::string &contract, const sclass_pair_t &pair);
+
+    /**
+     * The URIs of a pair's redirect rules that have no next-hops
+     */
+    std::set<std::string> blackholes(const sclass_pair_t &pair) const;
+
+    /**
+     * Show the pairs, from inspect
+     */
+    void show(std::ostream &os);
+
+  private:
+    /**
+     * Mutex protecting the pairs; written by rendering, read by inspect
+     */
+    mutable std::mutex m_mutex;
+
+    /**
+     * The pairs, with the contracts rendered for each and their
+     * redirect rules that have no next-hops
+     */
+    std::map<sclass_pair_t, std::map<std::string, std::set<std::string>>>
+        m_pairs;
+
+    /**
+     * The pairs each contract is rendered for
+     */
+    std::map<std::string, std::set<sclass_pair_t>> m_contracts;
+};
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
+
+#endif
@@ -7,6 +7,9 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <unordered_map>
+#include <unordered_set>
+
 #include <boost/optional.hpp>
 
 #include <opflexagent/Agent.h>
@@ -60,6 +63,23 @@ class EndPointGroupManager
 
     void handle_update(const opflex::modb::URI &epgURI);
 
+    /**
+     * Get the rendered group for an EPG. The forwarding state is built,
+     * and owned by the EPG, the first time it is requested and cached
+     * for subsequent endpoint updates until the EPG, the domains it
+     * was built from, its RD's config or the uplink's addresses change.
+     * It's built by rendering the EPG, so the state it replaces is
+     * swept.
+     */
+    std::shared_ptr<VOM::gbp_endpoint_group>
+    get_group(const opflex::modb::URI &epgURI);
+
+    /**
+     * Invalidate the cached forwarding state of the EPGs built from a
+     * domain; their RD, BD, FD or one of their subnets
+     */
+    void invalidate_groups(const opflex::modb::URI &domURI);
+
     static std::shared_ptr<VOM::gbp_endpoint_group>
     mk_group(Runtime &r,
              const std::string &key,
@@ -72,6 +92,11 @@ class EndPointGroupManager
               const VOM::route_domain &rd,
               uint32_t vnid);
 
+    /**
+     * Join the owner, by its key, to the tunnel of a multicast group
+     * for a VNI. The group's tunnels, and its join on the uplink, are
+     * shared by all the owners that join it.
+     */
     static std::shared_ptr<vxlan_tunnel>
     mk_mcast_tunnel(Runtime &r,
                     const std::string &key,
@@ -90,6 +115,25 @@ class EndPointGroupManager
      * Referene to runtime data.
      */
     Runtime &m_runtime;
+
+    /**
+     * A rendered group and the domains it was built from
+     */
+    struct group_t
+    {
+        std::shared_ptr<VOM::gbp_endpoint_group> group;
+        std::unordered_set<opflex::modb::URI> domains;
+    };
+
+    /**
+     * The rendered groups, keyed by EPG URI
+     */
+    std::unordered_map<opflex::modb::URI, group_t> m_groups;
+
+    /**
+     * The generation of the uplink the cached groups were built with
+     */
+    uint32_t m_uplink_gen;
 };
 };
 
@@ -7,9 +7,16 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <chrono>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "opflexagent/Agent.h"
+#include "opflexagent/EndpointManager.h"
 
 #include "VppRuntime.hpp"
 
@@ -22,6 +29,9 @@ class interface;
 
 namespace VPP
 {
+class EndPointGroupManager;
+class SecurityGroupManager;
+
 class EndPointManager : public VOM::interface::stat_listener
 {
   public:
@@ -29,10 +39,22 @@ class EndPointManager : public VOM::interface::stat_listener
     {
     };
 
-    EndPointManager(Runtime &runtime);
+    EndPointManager(Runtime &runtime,
+                    EndPointGroupManager &epgm,
+                    SecurityGroupManager &sgm);
     virtual ~EndPointManager();
 
     void handle_update(const std::string &uuid);
+
+    /**
+     * Render a batch of updated endpoints in one task. Each endpoint is
+     * still written under its own mark_n_sweep, and VOM sends each
+     * object's commands to VPP, and waits for the reply, as the object
+     * is written, since the objects written after it need its handle.
+     * So a batch saves the per-task overhead, but not the per-object
+     * flush to VPP.
+     */
+    void handle_batch_update(const std::unordered_set<std::string> &uuids);
     void handle_external_update(const std::string &uuid);
     void handle_remote_update(const std::string &uuid);
 
@@ -41,13 +63,53 @@ class EndPointManager : public VOM::interface::stat_listener
 
     virtual void handle_interface_stat(const interface &);
 
+    /**
+     * Aggregate the interface stats gathered since the last call into
+     * the endpoints' counters and publish them, in one update to the
+     * MODB. Called once the stats have been read from VPP, without VOM
+     * locked. The counters of endpoints the agent no longer has are
+     * dropped.
+     */
+    void publish_counters();
+
   private:
     void handle_update_i(const std::string &uuid, bool is_external);
 
     /**
-     * Event listener override to get Interface stats
+     * Render the endpoint
+     *
+     * @param itf_hdl set to the handle of the endpoint's interface, if
+     * it has one
+     * @param itf_name set to the name of the endpoint's interface
      */
-    void handle_interface_stat_i(const interface &);
+    void render_i(const std::string &uuid,
+                  bool is_external,
+                  handle_t &itf_hdl,
+                  std::string &itf_name);
+
+    /**
+     * Index the endpoint under the handle of its interface; an invalid
+     * handle removes it from the index
+     */
+    void index_interface(const std::string &uuid,
+                         const handle_t &hdl,
+                         const std::string &name);
+
+    /**
+     * The stats of an interface, as read
+     */
+    struct itf_stats_t
+    {
+        handle_t handle;
+        std::string name;
+        interface::stats_t stats;
+        std::chrono::steady_clock::time_point when;
+    };
+
+    /**
+     * Aggregate the stats of an interface into its endpoints' counters
+     */
+    void handle_interface_stat_i(const itf_stats_t &itf);
 
     static std::shared_ptr<interface> mk_bd_interface(
         const opflexagent::Endpoint &ep,
@@ -58,6 +120,70 @@ class EndPointManager : public VOM::interface::stat_listener
      * Referene to runtime data.
      */
     Runtime &m_runtime;
+
+    /**
+     * Reference to the EPG manager that holds the rendered groups
+     */
+    EndPointGroupManager &m_epgm;
+
+    /**
+     * Reference to the security group manager that holds the set rules
+     */
+    SecurityGroupManager &m_sgm;
+
+    /**
+     * The endpoints on an interface, and its name; VPP reuses the handles
+     * of deleted interfaces, e.g. once it restarts, so an entry is only
+     * valid for an interface of the same name
+     */
+    struct itf_eps_t
+    {
+        std::string name;
+        std::unordered_set<std::string> eps;
+    };
+
+    /**
+     * The endpoints on each interface, by the interface's handle, so the
+     * stats of an interface are attributed without asking the agent
+     */
+    std::unordered_map<uint32_t, itf_eps_t> m_itf_eps;
+
+    /**
+     * The handle of each endpoint's interface
+     */
+    std::unordered_map<std::string, uint32_t> m_ep_itf;
+
+    /**
+     * The names of the interfaces, by handle, that the agent has no
+     * endpoints on, e.g. the uplink or a BVI, so they're not looked up
+     * on every tick. An entry lasts until an endpoint is indexed under
+     * the handle.
+     */
+    std::unordered_map<uint32_t, std::string> m_itf_no_eps;
+
+    /**
+     * Mutex protecting the interface index; the stats are read outside
+     * of the task-queue
+     */
+    std::mutex m_itf_eps_mutex;
+
+    /**
+     * The stats of the interfaces read in the current tick
+     */
+    std::vector<itf_stats_t> m_stats;
+
+    /**
+     * Mutex protecting the interface stats read
+     */
+    std::mutex m_stats_mutex;
+
+    /**
+     * The counters of the endpoints gathered in the current stats tick.
+     * Filled and published in the context that reads the stats.
+     */
+    std::vector<
+        std::pair<std::string, opflexagent::EndpointManager::EpCounters>>
+        m_counters;
 };
 
 }; // namespace VPP
@@ -0,0 +1,181 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef __VPP_INTERFACE_RATES_H__
+#define __VPP_INTERFACE_RATES_H__
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include <boost/optional.hpp>
+
+#include <vom/inspect.hpp>
+#include <vom/interface.hpp>
+
+namespace VPP
+{
+/**
+ * The packet, byte and drop rates of the endpoint interfaces, computed
+ * from successive samples of their counters, and smoothed with an
+ * exponentially weighted moving average. Shown, with the drops by
+ * reason, by the 'rates' inspect command.
+ */
+class InterfaceRates : public VOM::inspect::command_handler
+{
+  public:
+    /**
+     * The packets an interface dropped, by reason
+     */
+    struct drops_t
+    {
+        /**
+         * Dropped by the forwarding graph
+         */
+        uint64_t drop;
+        /**
+         * Not received as the device's ring was full
+         */
+        uint64_t rx_miss;
+        /**
+         * Not received for want of a buffer
+         */
+        uint64_t rx_no_buf;
+        /**
+         * Received with errors
+         */
+        uint64_t rx_error;
+        /**
+         * Failed to transmit
+         */
+        uint64_t tx_error;
+
+        /**
+         * The drops in an interface's stats
+         */
+        static drops_t from(const VOM::interface::stats_t &stats);
+
+        /**
+         * The drops on receive and on transmit
+         */
+        uint64_t rx() const;
+        uint64_t tx() const;
+    };
+
+    /**
+     * A sample of an interface's counters
+     */
+    struct sample_t
+    {
+        std::chrono::steady_clock::time_point when;
+        uint64_t rx_packets;
+        uint64_t tx_packets;
+        uint64_t rx_bytes;
+        uint64_t tx_bytes;
+        drops_t drops;
+    };
+
+    /**
+     * Rates, per second
+     */
+    struct rate_t
+    {
+        double rx_pps;
+        double tx_pps;
+        double rx_bps;
+        double tx_bps;
+        double rx_drop_pps;
+        double tx_drop_pps;
+    };
+
+    /**
+     * VPP reports a counter it does not keep as all ones; report it as
+     * zero
+     */
+    static uint64_t sanitize(uint64_t value);
+
+    /**
+     * Construct, with the time constant of the average
+     */
+    InterfaceRates(std::chrono::seconds tau = std::chrono::seconds(30));
+
+    /**
+     * The instance the renderer reports to, registered with inspect
+     */
+    static InterfaceRates &get();
+
+    /**
+     * Add a sample of an interface's counters, and the endpoints on it
+     */
+    void update(uint32_t handle,
+                const std::string &name,
+                const std::unordered_set<std::string> &endpoints,
+                const sample_t &sample);
+
+    /**
+     * Forget an interface
+     */
+    void remove(uint32_t handle);
+
+    /**
+     * The rates over the last interval sampled, if there has been one
+     */
+    boost::optional<rate_t> last(uint32_t handle) const;
+
+    /**
+     * The average rates, if there has been an interval sampled
+     */
+    boost::optional<rate_t> average(uint32_t handle) const;
+
+    /**
+     * Show the rates, from inspect
+     */
+    void show(std::ostream &os);
+
+  private:
+    /**
+     * The state kept for an interface
+     */
+    struct itf_rates_t
+    {
+        std::string name;
+        std::unordered_set<std::string> endpoints;
+        sample_t sample;
+        bool has_rate;
+        rate_t last;
+        rate_t average;
+    };
+
+    /**
+     * The time constant of the average
+     */
+    double m_tau;
+
+    /**
+     * Mutex protecting the rates; written by the stats, read by inspect
+     */
+    mutable std::mutex m_mutex;
+
+    /**
+     * The rates per-interface handle
+     */
+    std::map<uint32_t, itf_rates_t> m_rates;
+};
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
+
+#endif
@@ -11,6 +11,7 @@
 #define __VPP_MANAGER_H__
 
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/address.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
@@ -20,6 +21,15 @@
 
 #include <opflex/ofcore/PeerStatusListener.h>
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 #include "opflexagent/Agent.h"
@@ -70,6 +80,37 @@ class VppManager : public opflexagent::EndpointListener,
 
     ~VppManager();
 
+    /**
+     * The state of the connection to VPP
+     */
+    enum class connection_state_t
+    {
+        /**
+         * Not yet started or stopped
+         */
+        DISCONNECTED,
+        /**
+         * Waiting for VPP to accept the connection
+         */
+        CONNECTING,
+        /**
+         * Connected and programming VPP
+         */
+        CONNECTED,
+    };
+
+    /**
+     * Return the state of the connection to VPP
+     */
+    connection_state_t getConnectionState();
+
+    /**
+     * Return the number of stale interfaces learnt at boot that are
+     * still to be removed from VPP. Also shown by the 'tasks' inspect
+     * command.
+     */
+    uint32_t getBootSweepRemaining() const;
+
     /**
      * Module start
      */
@@ -97,6 +138,36 @@ class VppManager : public opflexagent::EndpointListener,
                           bool routerAdv,
                           const std::string &mac);
 
+    /**
+     * Configure the batching of endpoint updates
+     *
+     * @param window_ms the time, in milliseconds, for which endpoint
+     * updates are collected before being rendered. zero disables
+     * batching and each update is rendered as it arrives.
+     * @param max_size the number of endpoints after which a batch is
+     * rendered without waiting for the window to expire
+     *
+     * A batch is rendered by one task, but is not sent to VPP in one
+     * flush; see EndPointManager::handle_batch_update.
+     */
+    void setEndpointBatch(uint32_t window_ms, uint32_t max_size);
+
+    /**
+     * Configure the batching of route updates; as for endpoints, but
+     * each routing domain's routes are batched, and rendered, apart.
+     */
+    void setRouteBatch(uint32_t window_ms, uint32_t max_size);
+
+    /**
+     * Configure when the state learnt from VPP at boot is swept
+     *
+     * @param quiet_ms the sweep runs once no update has been received,
+     * and none is pending, for this many milliseconds
+     * @param max_secs the time, in seconds after the platform config
+     * is received, after which the sweep runs regardless
+     */
+    void setBootSweep(uint32_t quiet_ms, uint32_t max_secs);
+
     /* Interface: EndpointListener */
     virtual void endpointUpdated(const std::string &uuid);
     virtual void externalEndpointUpdated(const std::string &uuid);
@@ -140,6 +211,11 @@ class VppManager : public opflexagent::EndpointListener,
      */
     VPP::Uplink &uplink();
 
+    /**
+     * Return the stats tiers
+     */
+    VPP::StatsTiers &statsTiers();
+
     /**
      * Return the cross connect object
      */
@@ -156,6 +232,13 @@ class VppManager : public opflexagent::EndpointListener,
     void handleDomainUpdate(opflex::modb::class_id_t cid,
                             const opflex::modb::URI &domURI);
 
+    /**
+     * Handle changes to the extra config of a routing domain
+     *
+     * @param rdURI URI of the routing domain
+     */
+    void handleRdConfigUpdate(const opflex::modb::URI &rdURI);
+
     /**
      * Compare and update changes in platform config
      *
@@ -186,6 +269,74 @@ class VppManager : public opflexagent::EndpointListener,
      */
     void handleInitConnection();
 
+    /**
+     * Handle the connect retry timeout
+     */
+    void handleConnectTimer(const boost::system::error_code &ec);
+
+    /**
+     * Hold the tasks whose writes to VPP failed, so they are run again
+     * once connected, before the updates held meanwhile. Those that have
+     * failed every retry are dropped.
+     */
+    void holdFailedTasks();
+
+    /**
+     * Bring up the renderer once VPP has accepted the connection; the
+     * held updates are released, in order, before any that follow
+     */
+    void handleConnected();
+
+    /**
+     * A task for the task-queue
+     */
+    struct task_t
+    {
+        /**
+         * The type of the task, against which its stats are kept
+         */
+        std::string type;
+        /**
+         * The task
+         */
+        std::function<void()> func;
+    };
+
+    /**
+     * Dispatch an update to the task-queue, or, while VPP is not
+     * connected, hold it until it is.
+     *
+     * @param type the type of the task, against which its stats are kept
+     * @param id the task's ID; only the latest task of an ID is run
+     * @param func the task
+     */
+    void dispatch(const std::string &type,
+                  const std::string &id,
+                  const std::function<void()> &func);
+
+    /**
+     * Queue or hold a task. The connection mutex is taken to decide
+     * which, and released before the task is queued.
+     */
+    void dispatchTask(const std::string &id, const task_t &task);
+
+    /**
+     * Add a task to the task-queue, recording its stats
+     */
+    void queueTask(const std::string &id, const task_t &task);
+
+    /**
+     * Is the renderer quiescent; no task is queued, held or running,
+     * no update is waiting to be batched, and none arrived in the quiet
+     * period.
+     *
+     * This approximates "all known endpoints are rendered": those the
+     * agent has notified have been, but endpoints it has yet to notify,
+     * e.g. while it's still resolving policy, are not known here. The
+     * quiet period is what covers them.
+     */
+    bool isConverged();
+
     /**
      * Handle a disconnect from VPP request
      */
@@ -201,21 +352,110 @@ class VppManager : public opflexagent::EndpointListener,
      */
     void handleXConnectConfigure();
 
+    /**
+     * Arm the endpoint batch timer, in the IO service context
+     */
+    void armEndpointBatch();
+
+    /**
+     * Handle the endpoint batch timeout
+     */
+    void handleEndpointBatchTimer(const boost::system::error_code &ec);
+
+    /**
+     * Render all the endpoints collected in the current batch
+     */
+    void handleEndpointBatch();
+
+    /**
+     * Handle an update to an external interface; its external subnets
+     * are rendered in the route batch
+     */
+    void handleExternalInterfaceUpdate(const opflex::modb::URI &uri);
+
+    /**
+     * The external subnets of an RD, or of an external interface, have
+     * changed; render them with the routes
+     */
+    void extNetsUpdated(const opflex::modb::URI &owner);
+
+    /**
+     * Add a route, or an owner of external subnets, to the batch
+     */
+    void batchRoute(const opflex::modb::URI &uri, bool ext_nets);
+
+    /**
+     * Arm the route batch timer, in the IO service context
+     */
+    void armRouteBatch();
+
+    /**
+     * Handle the route batch timeout
+     */
+    void handleRouteBatchTimer(const boost::system::error_code &ec);
+
+    /**
+     * Render the routes collected in the current batch
+     */
+    void handleRouteBatch();
+
+    /**
+     * Handle an update to a security group set
+     */
+    void handleSecGroupSetUpdate(const EndpointListener::uri_set_t &secGrps);
+
+    /**
+     * Handle an update to a security group
+     */
+    void handleSecGroupUpdate(const opflex::modb::URI &uri);
+
     /**
      * Handle the Vpp Boot request
      */
     void handleBoot();
 
     /**
-     * Handle the Vpp sweep timeout
+     * Handle the Vpp sweep timeout; sweep if the renderer has converged
+     * or the time bound has passed, else wait some more.
      */
     void handleSweepTimer(const boost::system::error_code &ec);
 
+    /**
+     * Arm the sweep timer to check for convergence again
+     */
+    void armSweepTimer();
+
+    /**
+     * Start the sweep of the state learnt at boot, in the task-queue
+     * context
+     */
+    void handleBootSweep();
+
+    /**
+     * Remove the next chunk of stale boot state
+     */
+    void handleBootSweepChunk();
+
     /**
      * Handle the HW poll timeout
      */
     void handleHWPollTimer(const boost::system::error_code &ec);
 
+    /**
+     * Run the stats IO service, in the stats thread
+     */
+    void runStats();
+
+    /**
+     * Stop the stats thread
+     */
+    void stopStats();
+
+    /**
+     * Arm the HW stats timer, in the stats thread
+     */
+    void armStatsTimer();
+
     /**
      * Pull the HW stats
      */
@@ -237,6 +477,37 @@ class VppManager : public opflexagent::EndpointListener,
      */
     std::unique_ptr<boost::asio::deadline_timer> m_sweep_timer;
 
+    /**
+     * The time the sweep was first scheduled
+     */
+    std::chrono::steady_clock::time_point m_sweep_start;
+
+    /**
+     * The quiet period, in ms, after which the boot state is swept
+     */
+    uint32_t m_sweep_quiet;
+
+    /**
+     * The time, in seconds, after which the boot state is swept anyway
+     */
+    uint32_t m_sweep_max;
+
+    /**
+     * Whether the boot state's sweep has been dispatched; it's swept
+     * once, whichever of convergence or the time bound comes first
+     */
+    std::atomic<bool> m_boot_swept;
+
+    /**
+     * The stale interfaces learnt at boot that are yet to be removed
+     */
+    std::deque<std::shared_ptr<VOM::interface>> m_boot_stale;
+
+    /**
+     * The number of stale boot interfaces yet to be removed
+     */
+    std::atomic<uint32_t> m_boot_stale_remaining;
+
     /**
      * CrossConnect interface manager
      */
@@ -248,19 +519,183 @@ class VppManager : public opflexagent::EndpointListener,
     std::unique_ptr<boost::asio::deadline_timer> m_poll_timer;
 
     /**
-     * The HW stats timer
+     * The IO service, run by its own thread at a low priority, in which
+     * the stats are read, so they don't hold up the agent's
+     */
+    boost::asio::io_service m_stats_io;
+    std::unique_ptr<boost::asio::io_service::work> m_stats_work;
+    std::thread m_stats_thread;
+
+    /**
+     * The HW stats timer, in the stats IO service
      */
     std::unique_ptr<boost::asio::deadline_timer> m_stats_timer;
 
+    /**
+     * The set of endpoints updated since the last batch was rendered
+     */
+    std::unordered_set<std::string> m_ep_batch;
+
+    /**
+     * Mutex protecting the endpoint batch; the set is filled from the
+     * notifying threads and drained in the task-queue context
+     */
+    std::mutex m_ep_batch_mutex;
+
+    /**
+     * The endpoint batch timer
+     */
+    std::unique_ptr<boost::asio::deadline_timer> m_ep_batch_timer;
+
+    /**
+     * Is the endpoint batch timer running
+     */
+    bool m_ep_batch_armed;
+
+    /**
+     * The window, in ms, over which endpoint updates are collected
+     */
+    uint32_t m_ep_batch_window;
+
+    /**
+     * The maximum number of endpoints in one batch
+     */
+    uint32_t m_ep_batch_max;
+
+    /**
+     * The updates collected in a route batch
+     */
+    struct route_batch_t
+    {
+        /**
+         * The local routes
+         */
+        std::unordered_set<opflex::modb::URI> routes;
+
+        /**
+         * The RDs and external interfaces whose external subnets are
+         * rendered
+         */
+        std::unordered_set<opflex::modb::URI> ext_nets;
+    };
+
+    /**
+     * The route updates since the last batch was rendered. A route's
+     * RD is resolved when it's rendered, in the task-queue, not here.
+     */
+    route_batch_t m_route_batch;
+
+    /**
+     * Mutex protecting the route batches
+     */
+    std::mutex m_route_batch_mutex;
+
+    /**
+     * The route batch timer
+     */
+    std::unique_ptr<boost::asio::deadline_timer> m_route_batch_timer;
+
+    /**
+     * Is the route batch timer running
+     */
+    bool m_route_batch_armed;
+
+    /**
+     * The window, in ms, over which route updates are collected
+     */
+    uint32_t m_route_batch_window;
+
+    /**
+     * The maximum number of updates in one batch
+     */
+    uint32_t m_route_batch_max;
+
     /**
      * indicator this manager is stopping
      */
     volatile bool stopping;
 
     /**
-     * indicator for hw liveness
+     * The state of the connection to VPP
+     */
+    connection_state_t m_conn_state;
+
+    /**
+     * Mutex protecting the connection state and the pending updates
+     */
+    std::mutex m_conn_mutex;
+
+    /**
+     * The updates held while VPP is not connected, and the order in
+     * which they first arrived
+     */
+    std::unordered_map<std::string, task_t> m_pending;
+    std::deque<std::string> m_pending_order;
+
+    /**
+     * The IDs of the tasks in the task-queue yet to run, and when they
+     * were first queued
+     */
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point>
+        m_queued;
+
+    /**
+     * Mutex protecting the queued tasks
+     */
+    std::mutex m_queued_mutex;
+
+    /**
+     * The number of tasks running; a task is no longer queued once it
+     * starts
+     */
+    std::atomic<uint32_t> m_running;
+
+    /**
+     * The tasks whose writes to VPP failed when last run, and the order
+     * in which they first failed. They're run again after reconnecting
+     * to a VPP that kept its state.
+     */
+    std::unordered_map<std::string, task_t> m_failed;
+    std::deque<std::string> m_failed_order;
+
+    /**
+     * The number of times each failed task has been retried; reset once
+     * the task succeeds
+     */
+    std::unordered_map<std::string, uint32_t> m_retries;
+
+    /**
+     * Mutex protecting the failed tasks
+     */
+    std::mutex m_failed_mutex;
+
+    /**
+     * The number of failed writes made outside of any task, as last
+     * seen by the poll, and whether any were lost with the connection;
+     * the writes of those can't be retried, so the state is replayed
+     */
+    uint64_t m_untracked_seen;
+    bool m_replay_all;
+
+    /**
+     * The time the last update was received
+     */
+    std::chrono::steady_clock::time_point m_last_update;
+
+    /**
+     * The connect retry timer
+     */
+    std::unique_ptr<boost::asio::deadline_timer> m_connect_timer;
+
+    /**
+     * The current connect retry backoff, in ms
+     */
+    uint32_t m_connect_backoff;
+
+    /**
+     * Source of the retry jitter
      */
-    bool hw_connected;
+    std::mt19937 m_connect_rand;
 
     void initPlatformConfig();
 
@@ -0,0 +1,120 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef __VPP_MULTICAST_GROUPS_H__
+#define __VPP_MULTICAST_GROUPS_H__
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+
+#include <boost/asio/ip/address.hpp>
+
+#include <vom/vxlan_tunnel.hpp>
+
+namespace VPP
+{
+class Uplink;
+
+/**
+ * The multicast groups that BDs flood to, shared between them. Each
+ * group address has one mroute and IGMP join on the uplink, and a
+ * tunnel per-VNI; both are written under keys of their own and
+ * counted by the owners, EPGs and external interfaces, that join them.
+ */
+class MulticastGroups
+{
+  public:
+    MulticastGroups(Uplink &uplink);
+
+    /**
+     * Join an owner to a group's tunnel for a VNI
+     *
+     * @return the tunnel
+     */
+    std::shared_ptr<VOM::vxlan_tunnel>
+    join(const std::string &owner, uint32_t vni, const std::string &maddr);
+
+    /**
+     * Made while an owner is rendered; the groups it was joined to
+     * before that it does not join again are left, together, when the
+     * render is done.
+     */
+    class sweep
+    {
+      public:
+        sweep(MulticastGroups &groups, const std::string &owner);
+        ~sweep();
+
+      private:
+        MulticastGroups &m_groups;
+        std::string m_owner;
+    };
+
+  private:
+    /**
+     * The source, group address and VNI of a tunnel
+     */
+    typedef std::tuple<boost::asio::ip::address,
+                       boost::asio::ip::address,
+                       uint32_t>
+        tunnel_key_t;
+
+    /**
+     * A tunnel and the owners joined to it
+     */
+    struct tunnel_t
+    {
+        std::shared_ptr<VOM::vxlan_tunnel> tunnel;
+        std::set<std::string> owners;
+    };
+
+    /**
+     * Mark the owner's joins as stale
+     */
+    void mark(const std::string &owner);
+
+    /**
+     * Leave the groups of the owner's stale joins
+     */
+    void leave(const std::string &owner);
+
+    /**
+     * The uplink the groups are joined on
+     */
+    Uplink &m_uplink;
+
+    /**
+     * The tunnels
+     */
+    std::map<tunnel_key_t, tunnel_t> m_tunnels;
+
+    /**
+     * The number of tunnels to each group address
+     */
+    std::map<boost::asio::ip::address, uint32_t> m_groups;
+
+    /**
+     * The tunnels each owner is joined to, and whether the join is
+     * stale
+     */
+    std::map<std::string, std::map<tunnel_key_t, bool>> m_owners;
+};
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
+
+#endif
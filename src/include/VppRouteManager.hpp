@@ -10,11 +10,20 @@
 #ifndef __VPP_ROUTE_MANAGER_H__
 #define __VPP_ROUTE_MANAGER_H__
 
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
 #include <opflexagent/Agent.h>
 
 #include <modelgbp/gbp/L3ExternalDomain.hpp>
 
+#include <vom/gbp_route_domain.hpp>
 #include <vom/route_domain.hpp>
+#include <vom/vxlan_tunnel.hpp>
 
 #include "VppRuntime.hpp"
 
@@ -28,17 +37,123 @@ class RouteManager
     void handle_domain_update(const opflex::modb::URI &uri);
     void handle_route_update(const opflex::modb::URI &uri);
 
+    /**
+     * Render a batch of route updates, and of the external subnets of
+     * their owners, all in the same routing domain, and record the
+     * rate at which they were rendered
+     */
+    void
+    handle_route_batch(const std::unordered_set<opflex::modb::URI> &uris,
+                       const std::unordered_set<opflex::modb::URI> &owners);
+
+    /**
+     * Render the external subnets of an RD, or of an external
+     * interface, under a key of their own; those of an owner that is
+     * gone are removed
+     */
+    void handle_ext_nets(const opflex::modb::URI &owner);
+
+  private:
     static void
     mk_ext_nets(Runtime &runtime,
                 route_domain &rd,
-                const opflex::modb::URI &uri,
+                const std::string &key,
                 std::shared_ptr<modelgbp::gbp::L3ExternalDomain> ext_dom);
 
-  private:
+    /**
+     * The source, destination and VNI of a GBP-L3 tunnel to a remote
+     * next-hop
+     */
+    typedef std::tuple<boost::asio::ip::address,
+                       boost::asio::ip::address,
+                       uint32_t>
+        tunnel_key_t;
+
+    /**
+     * A tunnel shared by the routes via its remote next-hop
+     */
+    struct tunnel_t
+    {
+        std::shared_ptr<VOM::vxlan_tunnel> tunnel;
+        std::set<std::string> routes;
+    };
+
+    /**
+     * Take a reference, for a route, to the tunnel to a remote
+     * next-hop; the tunnel, and its neighbour, are written the first
+     * time, under a key of their own.
+     */
+    std::shared_ptr<VOM::vxlan_tunnel>
+    acquire_tunnel(const std::string &route,
+                   const boost::asio::ip::address &nh,
+                   uint32_t vni,
+                   const VOM::route_domain &rd);
+
+    /**
+     * Release the references a route holds to tunnels, other than
+     * those given; tunnels with no references left are removed.
+     */
+    void release_tunnels(const std::string &route,
+                         const std::set<tunnel_key_t> &keep = {});
+
+    /**
+     * An internal subnet; its address and prefix length
+     */
+    typedef std::pair<std::string, uint8_t> subnet_t;
+
+    /**
+     * The internal subnets rendered in a routing domain, and the
+     * route-domain they were rendered in
+     */
+    struct rd_subnets_t
+    {
+        uint32_t rd_id;
+        uint32_t encap;
+        bool transport;
+
+        /**
+         * The subnets, with their parsed addresses
+         */
+        std::map<subnet_t, boost::asio::ip::address> subnets;
+    };
+
+    /**
+     * Render the internal subnets of an RD; only those added since it
+     * was last rendered are written, and those gone are removed. If
+     * the route-domain changed, all are rewritten.
+     */
+    void update_subnets(const std::string &rd_uuid,
+                        const VOM::gbp_route_domain &grd,
+                        uint32_t rd_id,
+                        uint32_t encap,
+                        const opflexagent::network::subnets_t &subnets);
+
+    /**
+     * Remove all the internal subnets rendered in an RD
+     */
+    void remove_subnets(const std::string &rd_uuid);
+
     /**
      * Reference to the runtime data
      */
     Runtime &m_runtime;
+
+    /**
+     * The tunnels to remote next-hops. Updated by route tasks, which
+     * run under the OM lock.
+     */
+    std::map<tunnel_key_t, tunnel_t> m_tunnels;
+
+    /**
+     * The tunnels each route references
+     */
+    std::map<std::string, std::set<tunnel_key_t>> m_route_tunnels;
+
+    /**
+     * The internal subnets rendered, per-RD. Updated by RD tasks,
+     * which run under the OM lock.
+     */
+    std::map<std::string, rd_subnets_t> m_rd_subnets;
 };
 }; // namespace VPP
 
@@ -10,9 +10,13 @@
 #ifndef __VPP_RUNTIME_H__
 #define __VPP_RUNTIME_H__
 
+#include <mutex>
+
 #include <opflexagent/Agent.h>
 
 #include "VppIdGen.hpp"
+#include "VppMulticastGroups.hpp"
+#include "VppStatsTiers.hpp"
 #include "VppUplink.hpp"
 #include "VppVirtualRouter.hpp"
 
@@ -23,7 +27,8 @@ struct Runtime
     Runtime(opflexagent::Agent &agent_, opflexagent::IdGenerator &idGen)
         : agent(agent_)
         , id_gen(idGen)
-        , uplink(agent)
+        , uplink(agent, om_mutex)
+        , mcast(uplink)
     {
     }
 
@@ -41,10 +46,21 @@ struct Runtime
      * ID generator instance
      */
     IdGen id_gen;
+    /**
+     * Serializes access to VOM's object model, and so to VPP, which is
+     * not thread-safe, between the task-queue, the uplink's DHCP events
+     * and the stats thread. Recursive since a task may run one it
+     * dispatches in place.
+     */
+    std::recursive_mutex om_mutex;
     /**
      * Uplink interface manager
      */
     Uplink uplink;
+    /**
+     * The multicast groups BDs flood to, joined on the uplink
+     */
+    MulticastGroups mcast;
     /**
      * Virtual Router Settings
      */
@@ -60,6 +76,11 @@ struct Runtime
      */
     bool is_transport_mode;
 
+    /**
+     * Which interfaces' stats are read, and how often
+     */
+    StatsTiers stats;
+
   private:
     Runtime(const Runtime &);
 };
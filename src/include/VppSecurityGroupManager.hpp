@@ -10,12 +10,17 @@
 #ifndef __VPP_SECURITY_GROUP_MANAGER_H__
 #define __VPP_SECURITY_GROUP_MANAGER_H__
 
+#include <unordered_map>
+#include <unordered_set>
+
 #include <opflexagent/Agent.h>
 #include <opflexagent/EndpointManager.h>
 
 #include <vom/acl_ethertype.hpp>
 #include <vom/acl_l3_list.hpp>
 
+#include "VppAclRules.hpp"
+
 using namespace VOM;
 
 namespace VPP
@@ -31,20 +36,88 @@ class SecurityGroupManager
                  const std::string &secGrpId,
                  ACL::l3_list::rules_t &in_rules,
                  ACL::l3_list::rules_t &out_rules,
-                 ACL::acl_ethertype::ethertype_rules_t &ethertype_rules);
+                 ACL::acl_ethertype::ethertype_rules_t &ethertype_rules,
+                 AclRules::origins_t &in_origins,
+                 AclRules::origins_t &out_origins);
 
     static std::string
     get_id(const opflexagent::EndpointListener::uri_set_t &secGrps);
 
+    /**
+     * Construct the name of an ACL from a 128 bit digest of its rules,
+     * so that all interfaces applying the same rules share the same VPP
+     * ACL, across deletions and restarts. An ACL of that name with
+     * other rules, a digest collision, is logged as an error.
+     */
+    static std::string get_acl_name(const ACL::l3_list::rules_t &rules);
+
+    /**
+     * Add the rules of the security group set to those given.
+     * The rules of a set are built once and reused by all its endpoints
+     * until the set, or one of its groups, is updated, or no endpoint
+     * uses it. The origins of the rules, before they were compiled, are
+     * added to those given.
+     *
+     * @param owner the endpoint the rules are for, which uses the set
+     * until it's released or gets the rules of another set
+     */
+    void get_rules(const std::string &owner,
+                   const opflexagent::EndpointListener::uri_set_t &secGrps,
+                   ACL::l3_list::rules_t &in_rules,
+                   ACL::l3_list::rules_t &out_rules,
+                   ACL::acl_ethertype::ethertype_rules_t &ethertype_rules,
+                   AclRules::origins_t &in_origins,
+                   AclRules::origins_t &out_origins);
+
+    /**
+     * Release the set the owner uses; the rules of a set that no owner
+     * uses are forgotten.
+     */
+    void release(const std::string &owner);
+
+    /**
+     * Handle an update to a security group set; flush its rules and
+     * return the endpoints that use it, which need to be re-rendered.
+     */
     void
-    handle_set_update(const opflexagent::EndpointListener::uri_set_t &secGrps);
-    void handle_update(const opflex::modb::URI &uri);
+    handle_set_update(const opflexagent::EndpointListener::uri_set_t &secGrps,
+                      std::unordered_set<std::string> &eps);
+
+    /**
+     * Handle an update to a security group; flush the rules of all sets
+     * that contain it and return the endpoints that use them.
+     */
+    void handle_update(const opflex::modb::URI &uri,
+                       std::unordered_set<std::string> &eps);
 
   private:
+    /**
+     * The rules built for a security group set
+     */
+    struct set_rules_t
+    {
+        ACL::l3_list::rules_t in_rules;
+        ACL::l3_list::rules_t out_rules;
+        ACL::acl_ethertype::ethertype_rules_t ethertype_rules;
+        AclRules::origins_t in_origins;
+        AclRules::origins_t out_origins;
+        std::unordered_set<std::string> owners;
+    };
+
     /**
      * Referene to the uber-agent
      */
     opflexagent::Agent &m_agent;
+
+    /**
+     * The rules of each security group set, keyed by set ID
+     */
+    std::unordered_map<std::string, set_rules_t> m_set_rules;
+
+    /**
+     * The set each owner uses, by set ID
+     */
+    std::unordered_map<std::string, std::string> m_owner_set;
 };
 }; // namespace VPP
 
@@ -10,6 +10,9 @@
 #ifndef __VPP_SPINE_PROXY_H__
 #define __VPP_SPINE_PROXY_H__
 
+#include <map>
+#include <memory>
+
 #include <boost/asio/ip/address.hpp>
 
 namespace VOM
@@ -50,6 +53,14 @@ class SpineProxy
     boost::asio::ip::address_v4 m_remote_v4;
     boost::asio::ip::address_v4 m_remote_v6;
     boost::asio::ip::address_v4 m_remote_mac;
+
+    /**
+     * The tunnels made, by destination and VNI. Each is written, under
+     * the caller's key, by every call, but built only once.
+     */
+    std::map<std::pair<boost::asio::ip::address_v4, uint32_t>,
+             std::shared_ptr<VOM::vxlan_tunnel>>
+        m_tunnels;
 };
 }; // namespace VPP
 
@@ -0,0 +1,181 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef __VPP_STATS_TIERS_H__
+#define __VPP_STATS_TIERS_H__
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <vom/interface.hpp>
+
+namespace VPP
+{
+/**
+ * Which interfaces have their stats read from VPP, and how often.
+ * Each class of interface is in a tier; the fast tier is read every
+ * tick, the slow tier at a longer interval and the rest not at all.
+ * The stats of the slow tier's interfaces are enabled in VOM only for
+ * the ticks it is read.
+ */
+class StatsTiers : public VOM::interface::stat_listener
+{
+  public:
+    /**
+     * How often stats are read
+     */
+    enum class tier_t
+    {
+        FAST,
+        SLOW,
+        OFF,
+    };
+
+    /**
+     * The classes of interface
+     */
+    enum class class_t
+    {
+        /**
+         * The interface of an endpoint
+         */
+        ENDPOINT,
+        /**
+         * The uplink sub-interface or tunnel of a group
+         */
+        UPLINK,
+        /**
+         * The BVI of a group
+         */
+        BVI,
+    };
+
+    StatsTiers();
+
+    /**
+     * Parse a tier from its name in the config; fast, slow or off
+     */
+    static boost::optional<tier_t> parse(const std::string &name);
+
+    /**
+     * Set the intervals, in seconds, of the two tiers
+     */
+    void set_intervals(uint32_t fast_secs, uint32_t slow_secs);
+
+    /**
+     * Set the tier of a class of interface
+     */
+    void set_tier(class_t cls, tier_t tier);
+
+    /**
+     * The interval, in seconds, at which the stats are read
+     */
+    uint32_t fast_interval() const;
+
+    /**
+     * Enable the stats of an interface, as its class' tier says
+     *
+     * @param listener to receive the interface's stats; the default
+     * only records its rates
+     */
+    void add(const std::shared_ptr<VOM::interface> &itf,
+             class_t cls,
+             VOM::interface::stat_listener *listener = nullptr);
+
+    /**
+     * Read the stats for a tick, including the slow tier's if it is
+     * due.
+     *
+     * @param om_mutex the mutex serializing access to VOM's object
+     * model; held only to enable the stats of the interfaces added
+     * since the last read, and to take a reference to those read
+     */
+    void read(std::recursive_mutex &om_mutex);
+
+    /**
+     * Record the rates of the interfaces we listen to, and pass on the
+     * slow tier's stats
+     */
+    virtual void handle_interface_stat(const VOM::interface &itf);
+
+  private:
+    /**
+     * An interface whose stats are enabled
+     */
+    struct itf_t
+    {
+        std::weak_ptr<VOM::interface> itf;
+        VOM::interface::stat_listener *listener;
+        uint32_t handle;
+    };
+
+    /**
+     * Mutex protecting the tiers; interfaces are added by rendering
+     * and read by the stats thread
+     */
+    mutable std::mutex m_mutex;
+
+    /**
+     * The tier of each class
+     */
+    std::map<class_t, tier_t> m_tiers;
+
+    /**
+     * The intervals of the two tiers, in seconds
+     */
+    uint32_t m_fast_secs;
+    uint32_t m_slow_secs;
+
+    /**
+     * The last time the slow tier was read
+     */
+    std::chrono::steady_clock::time_point m_slow_last;
+
+    /**
+     * The slow tier's interfaces, by name. Their stats are enabled,
+     * with us as the listener, only for the reads the slow tier is due;
+     * they are passed on to their listener.
+     */
+    std::map<std::string, itf_t> m_slow;
+
+    /**
+     * The interfaces added since the last read, whose stats are to be
+     * enabled
+     */
+    std::vector<itf_t> m_adding;
+
+    /**
+     * The fast tier's interfaces, whose stats are enabled
+     */
+    std::set<std::weak_ptr<VOM::interface>,
+             std::owner_less<std::weak_ptr<VOM::interface>>>
+        m_enabled;
+
+    /**
+     * The interfaces, by name, whose stats we listen to
+     */
+    std::map<std::string, itf_t> m_own;
+};
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
+
+#endif
@@ -0,0 +1,224 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef __VPP_TASK_STATS_H__
+#define __VPP_TASK_STATS_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+
+#include <vom/hw.hpp>
+#include <vom/inspect.hpp>
+
+namespace VPP
+{
+/**
+ * A histogram of values with logarithmic buckets, each split into
+ * linear sub-buckets, as an HDR histogram has, so that the relative
+ * error of each recorded value is bounded by 1/SUB_BUCKETS, in a fixed
+ * and small amount of memory.
+ */
+class Histogram
+{
+  public:
+    Histogram();
+
+    /**
+     * Record a value
+     */
+    void record(uint64_t value);
+
+    /**
+     * The number of values recorded
+     */
+    uint64_t count() const;
+
+    /**
+     * The largest value recorded
+     */
+    uint64_t max() const;
+
+    /**
+     * The mean of the values recorded
+     */
+    uint64_t mean() const;
+
+    /**
+     * The value below which the given percentage of values fall, to
+     * within the precision of the buckets
+     */
+    uint64_t percentile(double pct) const;
+
+  private:
+    static const uint32_t SUB_BITS = 3;
+    static const uint32_t SUB_BUCKETS = (1 << SUB_BITS);
+    static const uint32_t MAX_BITS = 40;
+    static const uint32_t N_BUCKETS = (MAX_BITS - SUB_BITS + 2) * SUB_BUCKETS;
+
+    static uint32_t index(uint64_t value);
+    static uint64_t value(uint32_t index);
+
+    std::array<uint64_t, N_BUCKETS> m_buckets;
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_max;
+};
+
+/**
+ * The statistics of the tasks run by the VppManager, per type of task;
+ * how long they wait in the queue, how long they take to run and how
+ * many commands they send to VPP. Also the depth of the queue.
+ * Shown by the 'tasks' inspect command.
+ */
+class TaskStats : public VOM::inspect::command_handler
+{
+  public:
+    /**
+     * The singular instance
+     */
+    static TaskStats &get();
+
+    /**
+     * Run a task, of the given type, and record its stats
+     *
+     * @return whether any of the task's writes to VPP failed
+     */
+    bool run(const std::string &type,
+             const std::chrono::steady_clock::time_point &queued,
+             const std::function<void()> &func);
+
+    /**
+     * Update the depth of the task queue
+     */
+    void queued(size_t depth);
+
+    /**
+     * Update the number of stale interfaces learnt at boot still to be
+     * removed by the boot sweep
+     */
+    void boot_stale(size_t remaining);
+
+    /**
+     * Count commands sent to VPP
+     */
+    void issued(size_t n_cmds);
+
+    /**
+     * Count a write of commands to VPP that failed. It's credited to
+     * the task running on this thread, if there is one.
+     */
+    void failed();
+
+    /**
+     * The number of failed writes made outside of any task
+     */
+    uint64_t untracked_failures() const;
+
+    /**
+     * Record the number of items, e.g. routes, a task of the given type
+     * rendered, and the time it took, for the task's rate
+     */
+    void rendered(const std::string &type,
+                  size_t n_items,
+                  std::chrono::microseconds took);
+
+    /**
+     * Show the stats, from inspect
+     */
+    void show(std::ostream &os);
+
+  private:
+    TaskStats();
+
+    /**
+     * The stats of a type of task
+     */
+    struct task_stats_t
+    {
+        /**
+         * Enqueue to start, in microseconds
+         */
+        Histogram queue;
+        /**
+         * Start to end, in microseconds
+         */
+        Histogram exec;
+        /**
+         * Number of commands sent to VPP
+         */
+        Histogram cmds;
+        /**
+         * Number of items rendered, and the rate, in items per second,
+         * of those tasks that report them
+         */
+        Histogram items;
+        Histogram rate;
+    };
+
+    /**
+     * Mutex protecting the stats; written from the task queue, read
+     * from inspect
+     */
+    std::mutex m_mutex;
+
+    /**
+     * The stats per task type
+     */
+    std::map<std::string, task_stats_t> m_tasks;
+
+    /**
+     * The current and largest depth of the task queue
+     */
+    std::atomic<size_t> m_depth;
+    std::atomic<size_t> m_depth_max;
+
+    /**
+     * The number of stale boot interfaces still to be removed
+     */
+    std::atomic<size_t> m_boot_stale;
+
+    /**
+     * The number of commands sent to VPP
+     */
+    std::atomic<uint64_t> m_cmds;
+
+    /**
+     * The number of failed writes, and of those made outside any task
+     */
+    std::atomic<uint64_t> m_failed;
+    std::atomic<uint64_t> m_untracked;
+};
+
+/**
+ * A VPP command queue that counts, for the task stats, the commands
+ * issued through it, and the writes of them that fail
+ */
+class CountingCmdQ : public VOM::HW::cmd_q
+{
+  public:
+    void enqueue(VOM::cmd *c);
+    void enqueue(std::shared_ptr<VOM::cmd> c);
+    void enqueue(std::queue<VOM::cmd *> &c);
+    VOM::rc_t write();
+};
+
+}; // namespace VPP
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
+
+#endif
@@ -10,6 +10,8 @@
 #ifndef __VPP_UPLINK_H__
 #define __VPP_UPLINK_H__
 
+#include <atomic>
+#include <mutex>
 #include <unordered_set>
 
 #include "opflexagent/Agent.h"
@@ -49,8 +51,10 @@ class Uplink : public dhcp_client::event_listener
 
     /**
      * Default Constructor
+     *
+     * @param om_mutex the mutex serializing writes to VOM's object model
      */
-    Uplink(opflexagent::Agent &agent);
+    Uplink(opflexagent::Agent &agent, std::recursive_mutex &om_mutex);
 
     /**
      * Given the VNID, create an interface of the appropriate type
@@ -97,7 +101,23 @@ class Uplink : public dhcp_client::event_listener
      */
     void handle_dhcp_event(std::shared_ptr<dhcp_client::lease_t> lease);
 
+    /**
+     * The spine proxy, in transport mode. Built once and kept until the
+     * local address or the proxy addresses may have changed.
+     */
     std::shared_ptr<SpineProxy> spine_proxy();
+
+    /**
+     * Forget the spine proxy; the next use builds it again
+     */
+    void reset_spine_proxy();
+
+    /**
+     * The generation of the uplink's addresses, and so of the spine
+     * proxy; it changes each time the proxy is reset. State built from
+     * them is stale once it has changed.
+     */
+    uint32_t generation() const;
     const std::string &system_name() const;
 
   private:
@@ -158,7 +178,25 @@ class Uplink : public dhcp_client::event_listener
      */
     opflexagent::Agent &m_agent;
 
+    /**
+     * The mutex serializing writes to VOM's object model; held by DHCP
+     * events, which reconfigure the uplink outside of any task
+     */
+    std::recursive_mutex &m_om_mutex;
+
     route::prefix_t m_pfx;
+
+    /**
+     * The spine proxy, and the mutex protecting it; it's used by the
+     * rendering tasks and reset by DHCP events
+     */
+    std::shared_ptr<SpineProxy> m_spine_proxy;
+    std::mutex m_spine_proxy_mutex;
+
+    /**
+     * The generation of the addresses
+     */
+    std::atomic<uint32_t> m_generation;
 };
 };
 
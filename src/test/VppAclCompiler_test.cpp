@@ -0,0 +1,256 @@
+/*
+ * Test suite for VppAclCompiler
+ *
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <chrono>
+#include <random>
+
+#include <boost/test/unit_test.hpp>
+
+#include "VppAclCompiler.hpp"
+
+using namespace VOM;
+using namespace VPP;
+using boost::asio::ip::address_v4;
+
+BOOST_AUTO_TEST_SUITE(VppAclCompiler_test)
+
+struct packet_t
+{
+    address_v4 src;
+    address_v4 dst;
+    uint8_t proto;
+    uint16_t sport;
+    uint16_t dport;
+    uint8_t flags;
+};
+
+/**
+ * The action of the first rule matching the packet, as the ACL plugin
+ * would evaluate it; -1 for no match.
+ */
+static int
+classify(const ACL::l3_list::rules_t &rules, const packet_t &p)
+{
+    for (auto &r : rules)
+    {
+        if (AclCompiler::contains(r.src(), route::prefix_t(p.src, 32)) &&
+            AclCompiler::contains(r.dst(), route::prefix_t(p.dst, 32)) &&
+            (0 == r.proto() ||
+             (r.proto() == p.proto &&
+              r.srcport_or_icmptype_first() <= p.sport &&
+              p.sport <= r.srcport_or_icmptype_last() &&
+              r.dstport_or_icmpcode_first() <= p.dport &&
+              p.dport <= r.dstport_or_icmpcode_last() &&
+              (p.flags & r.tcp_flags_mask()) == r.tcp_flags_value())))
+            return r.action().value();
+    }
+    return -1;
+}
+
+static ACL::l3_rule
+mk_rule(uint32_t priority,
+        const ACL::action_t &act,
+        const std::string &src,
+        uint8_t src_len,
+        uint8_t proto,
+        uint16_t dp_first,
+        uint16_t dp_last)
+{
+    return ACL::l3_rule(priority,
+                        act,
+                        route::prefix_t(src, src_len),
+                        route::prefix_t::ZERO,
+                        proto,
+                        0,
+                        65535,
+                        dp_first,
+                        dp_last,
+                        0,
+                        0);
+}
+
+/**
+ * A security group set as an orchestrator might render it; a rule per
+ * remote subnet and per port, some of them repeated by other groups.
+ */
+static ACL::l3_list::rules_t
+mk_rules()
+{
+    ACL::l3_list::rules_t rules;
+    uint32_t prio = 10000;
+
+    /* a deny for ssh from a management range */
+    rules.insert(
+        mk_rule(prio--, ACL::action_t::DENY, "10.2.0.0", 16, 6, 22, 22));
+
+    /* https from 64 consecutive /24s */
+    for (int i = 0; i < 64; i++)
+        rules.insert(mk_rule(prio--,
+                             ACL::action_t::PERMIT,
+                             "10.1." + std::to_string(i) + ".0",
+                             24,
+                             6,
+                             443,
+                             443));
+
+    /* an application port range, one rule per port */
+    for (int i = 8000; i < 8100; i++)
+        rules.insert(
+            mk_rule(prio--, ACL::action_t::PERMIT, "0.0.0.0", 0, 6, i, i));
+
+    /* ssh from the management range again; shadowed by the deny */
+    for (int i = 0; i < 16; i++)
+        rules.insert(mk_rule(prio--,
+                             ACL::action_t::PERMIT,
+                             "10.2." + std::to_string(i) + ".0",
+                             24,
+                             6,
+                             22,
+                             22));
+
+    /* ssh from anywhere; cannot be merged above the deny */
+    rules.insert(
+        mk_rule(prio--, ACL::action_t::PERMIT, "0.0.0.0", 0, 6, 22, 22));
+    rules.insert(
+        mk_rule(prio--, ACL::action_t::PERMIT, "0.0.0.0", 0, 6, 23, 23));
+
+    /* https from a subnet already allowed */
+    rules.insert(
+        mk_rule(prio--, ACL::action_t::PERMIT, "10.1.7.0", 25, 6, 443, 443));
+
+    /* udp dns */
+    rules.insert(
+        mk_rule(prio--, ACL::action_t::PERMIT, "0.0.0.0", 0, 17, 53, 53));
+
+    return rules;
+}
+
+static packet_t
+mk_packet(std::mt19937 &gen)
+{
+    std::uniform_int_distribution<uint32_t> any;
+    std::uniform_int_distribution<int> pick(0, 3);
+    packet_t p;
+
+    p.src = address_v4(any(gen));
+    p.dst = address_v4(any(gen));
+    p.proto = (pick(gen) ? 6 : 17);
+    p.sport = any(gen);
+    p.dport = any(gen);
+    p.flags = any(gen);
+
+    /*
+     * bias the packets toward the addresses and ports the rules use
+     */
+    if (pick(gen)) p.src = address_v4((10 << 24) | (any(gen) % 0x30000));
+    switch (pick(gen))
+    {
+    case 0:
+        p.dport = 8000 + any(gen) % 110;
+        break;
+    case 1:
+        p.dport = 20 + any(gen) % 5;
+        break;
+    case 2:
+        p.dport = (any(gen) & 1 ? 443 : 53);
+        break;
+    }
+    return p;
+}
+
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+    ACL::l3_list::rules_t rules = mk_rules();
+
+    auto start = std::chrono::steady_clock::now();
+    ACL::l3_list::rules_t compiled = AclCompiler::compile(rules);
+    auto usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    BOOST_TEST_MESSAGE("ACL rules before:" << rules.size()
+                                           << " after:" << compiled.size()
+                                           << " in " << usecs.count()
+                                           << "us");
+
+    /*
+     * the deny, one https /18, one port range, ssh & telnet, dns
+     */
+    BOOST_CHECK_EQUAL(rules.size(), 185);
+    BOOST_CHECK_EQUAL(compiled.size(), 5);
+
+    std::mt19937 gen(1);
+    for (int i = 0; i < 100000; i++)
+    {
+        packet_t p = mk_packet(gen);
+        BOOST_REQUIRE_EQUAL(classify(rules, p), classify(compiled, p));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(merge_blocked)
+{
+    ACL::l3_list::rules_t rules;
+
+    rules.insert(
+        mk_rule(300, ACL::action_t::PERMIT, "0.0.0.0", 0, 6, 80, 80));
+    rules.insert(mk_rule(200, ACL::action_t::DENY, "10.0.0.0", 8, 6, 81, 81));
+    rules.insert(
+        mk_rule(100, ACL::action_t::PERMIT, "0.0.0.0", 0, 6, 81, 81));
+
+    BOOST_CHECK_EQUAL(AclCompiler::compile(rules).size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(distinct)
+{
+    ACL::l3_list::rules_t rules;
+
+    rules.insert(ACL::l3_rule(8192,
+                              ACL::action_t::PERMIT,
+                              route::prefix_t::ZERO,
+                              route::prefix_t::ZERO,
+                              6,
+                              0,
+                              65535,
+                              80,
+                              65535,
+                              0,
+                              0));
+    rules.insert(ACL::l3_rule(7808,
+                              ACL::action_t::PERMIT,
+                              route::prefix_t::ZERO,
+                              route::prefix_t::ZERO,
+                              6,
+                              22,
+                              65535,
+                              0,
+                              65535,
+                              3,
+                              3));
+    rules.insert(ACL::l3_rule(7680,
+                              ACL::action_t::PERMIT,
+                              route::prefix_t::ZERO,
+                              route::prefix_t::ZERO,
+                              6,
+                              21,
+                              65535,
+                              0,
+                              65535,
+                              16,
+                              16));
+
+    BOOST_CHECK(AclCompiler::compile(rules) == rules);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
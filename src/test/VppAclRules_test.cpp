@@ -0,0 +1,141 @@
+/*
+ * Test suite for VppAclRules
+ *
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "VppAclRules.hpp"
+
+using namespace VOM;
+using namespace VPP;
+
+BOOST_AUTO_TEST_SUITE(VppAclRules_test)
+
+static ACL::l3_rule
+mk_rule(uint32_t priority,
+        const ACL::action_t &act,
+        const std::string &src,
+        uint8_t src_len)
+{
+    return ACL::l3_rule(priority,
+                        act,
+                        route::prefix_t(src, src_len),
+                        route::prefix_t::ZERO,
+                        6,
+                        0,
+                        65535,
+                        80,
+                        80,
+                        0,
+                        0);
+}
+
+BOOST_AUTO_TEST_CASE(origins)
+{
+    AclRules ar;
+    AclRules::origins_t origins;
+
+    /*
+     * two sibling rules, compiled into their parent, and a rule with
+     * the other action that the parent shadows
+     */
+    origins[mk_rule(100, ACL::action_t::PERMIT, "10.0.0.0", 24)].insert("A");
+    origins[mk_rule(90, ACL::action_t::PERMIT, "10.0.1.0", 24)].insert("B");
+    origins[mk_rule(80, ACL::action_t::DENY, "10.0.0.0", 24)].insert("C");
+
+    ACL::l3_list::rules_t rules = {
+        mk_rule(100, ACL::action_t::PERMIT, "10.0.0.0", 23),
+        mk_rule(10, ACL::action_t::DENY, "0.0.0.0", 0)};
+
+    ar.add("ep1", "acl1", rules, origins);
+
+    BOOST_CHECK(ar.uris("acl1", 0) == std::set<std::string>({"A", "B"}));
+    BOOST_CHECK(ar.uris("acl1", 1).empty());
+    BOOST_CHECK(ar.shadowed("acl1") == std::set<std::string>({"C"}));
+
+    /*
+     * the ACL is kept until its last owner is removed
+     */
+    ar.add("ep2", "acl1", rules, origins);
+    ar.remove("ep1");
+    BOOST_CHECK_EQUAL(ar.uris("acl1", 0).size(), 2);
+    ar.remove("ep2");
+    BOOST_CHECK(ar.uris("acl1", 0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(owners_origins)
+{
+    AclRules ar;
+    AclRules::origins_t o1, o2;
+
+    /*
+     * two owners render the same ACL from different opflex rules
+     */
+    o1[mk_rule(100, ACL::action_t::PERMIT, "10.0.0.0", 24)].insert("A");
+    o2[mk_rule(100, ACL::action_t::PERMIT, "10.0.0.0", 24)].insert("B");
+    o2[mk_rule(90, ACL::action_t::DENY, "10.0.0.0", 24)].insert("C");
+
+    ACL::l3_list::rules_t rules = {
+        mk_rule(100, ACL::action_t::PERMIT, "10.0.0.0", 24)};
+
+    ar.add("ep1", "acl1", rules, o1);
+    ar.add("ep2", "acl1", rules, o2);
+
+    BOOST_CHECK(ar.uris("acl1", 0) == std::set<std::string>({"A", "B"}));
+    BOOST_CHECK(ar.shadowed("acl1") == std::set<std::string>({"C"}));
+
+    /*
+     * an owner's origins go with it
+     */
+    ar.remove("ep2");
+    BOOST_CHECK(ar.uris("acl1", 0) == std::set<std::string>({"A"}));
+    BOOST_CHECK(ar.shadowed("acl1").empty());
+
+    /*
+     * and are replaced when it adds the ACL again
+     */
+    ar.add("ep1", "acl1", rules, o2);
+    BOOST_CHECK(ar.uris("acl1", 0) == std::set<std::string>({"B"}));
+}
+
+BOOST_AUTO_TEST_CASE(equal_priorities)
+{
+    AclRules ar;
+    AclRules::origins_t origins;
+
+    /*
+     * the rules built from each remote subnet of a classifier share its
+     * priority, but are not the same rule
+     */
+    origins[mk_rule(100, ACL::action_t::PERMIT, "10.0.0.0", 24)].insert("A");
+    origins[mk_rule(100, ACL::action_t::PERMIT, "10.0.2.0", 24)].insert("B");
+    origins[mk_rule(100, ACL::action_t::PERMIT, "10.0.0.0", 24)].insert("C");
+    BOOST_CHECK_EQUAL(origins.size(), 2);
+
+    ACL::l3_list::rules_t rules = {
+        mk_rule(100, ACL::action_t::PERMIT, "10.0.0.0", 24),
+        mk_rule(100, ACL::action_t::PERMIT, "10.0.2.0", 24)};
+
+    ar.add("ep1", "acl1", rules, origins);
+
+    std::set<std::string> uris = ar.uris("acl1", 0);
+    std::set<std::string> more = ar.uris("acl1", 1);
+
+    uris.insert(more.begin(), more.end());
+    BOOST_CHECK(uris == std::set<std::string>({"A", "B", "C"}));
+    BOOST_CHECK(ar.shadowed("acl1").empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
@@ -0,0 +1,64 @@
+/*
+ * Test suite for VppContractPairs
+ *
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "VppContractPairs.hpp"
+
+using namespace VPP;
+
+BOOST_AUTO_TEST_SUITE(VppContractPairs_test)
+
+BOOST_AUTO_TEST_CASE(pairs)
+{
+    ContractPairs cp;
+    ContractPairs::sclass_pair_t p1(100, 200), p2(200, 100);
+
+    cp.add("c1", p1, {});
+    cp.add("c1", p2, {"rule2"});
+    cp.add("c2", p1, {"rule1"});
+
+    BOOST_CHECK(cp.blackholes(p1) == std::set<std::string>({"rule1"}));
+    BOOST_CHECK(cp.blackholes(p2) == std::set<std::string>({"rule2"}));
+
+    /*
+     * a pair is kept while any contract is rendered for it
+     */
+    cp.remove("c2");
+    BOOST_CHECK(cp.blackholes(p1).empty());
+    BOOST_CHECK(cp.blackholes(p2) == std::set<std::string>({"rule2"}));
+    cp.remove("c1");
+    BOOST_CHECK(cp.blackholes(p2).empty());
+
+    /*
+     * adding a contract's pair again replaces its blackholes
+     */
+    cp.add("c1", p1, {"rule1"});
+    cp.add("c1", p1, {});
+    BOOST_CHECK(cp.blackholes(p1).empty());
+
+    /*
+     * removing one pair of a contract leaves its others
+     */
+    cp.add("c1", p2, {"rule2"});
+    cp.add("c2", p1, {"rule1"});
+    cp.remove("c2", p1);
+    cp.remove("c1", p1);
+    BOOST_CHECK(cp.blackholes(p1).empty());
+    BOOST_CHECK(cp.blackholes(p2) == std::set<std::string>({"rule2"}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
@@ -0,0 +1,136 @@
+/*
+ * Test suite for VppInterfaceRates
+ *
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <cmath>
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "VppInterfaceRates.hpp"
+
+using namespace VPP;
+
+BOOST_AUTO_TEST_SUITE(VppInterfaceRates_test)
+
+static InterfaceRates::sample_t
+mk_sample(uint32_t secs, uint64_t packets, uint64_t bytes)
+{
+    return {std::chrono::steady_clock::time_point(std::chrono::seconds(secs)),
+            packets,
+            packets / 2,
+            bytes,
+            bytes / 2};
+}
+
+BOOST_AUTO_TEST_CASE(rates)
+{
+    InterfaceRates ir(std::chrono::seconds(10));
+
+    ir.update(1, "tap0", {"ep1"}, mk_sample(100, 1000, 64000));
+    BOOST_CHECK(!ir.last(1));
+    BOOST_CHECK(!ir.average(1));
+
+    /*
+     * 1000 packets of 64 bytes in 5 seconds
+     */
+    ir.update(1, "tap0", {"ep1"}, mk_sample(105, 6000, 384000));
+    BOOST_REQUIRE(ir.last(1));
+    BOOST_CHECK_CLOSE(ir.last(1).get().rx_pps, 1000, 0.001);
+    BOOST_CHECK_CLOSE(ir.last(1).get().tx_pps, 500, 0.001);
+    BOOST_CHECK_CLOSE(ir.last(1).get().rx_bps, 512000, 0.001);
+    BOOST_CHECK_CLOSE(ir.average(1).get().rx_pps, 1000, 0.001);
+
+    /*
+     * the sample is late, and the rate halves. the average moves a
+     * share of the way there, given by the time since the last
+     */
+    ir.update(1, "tap0", {"ep1"}, mk_sample(115, 11000, 704000));
+    BOOST_CHECK_CLOSE(ir.last(1).get().rx_pps, 500, 0.001);
+    BOOST_CHECK_CLOSE(
+        ir.average(1).get().rx_pps, 1000 - 500 * (1 - std::exp(-1.0)), 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(reset)
+{
+    InterfaceRates ir;
+
+    ir.update(1, "tap0", {"ep1"}, mk_sample(100, 1000, 64000));
+    ir.update(1, "tap0", {"ep1"}, mk_sample(105, 6000, 384000));
+
+    /*
+     * the counters are reset; no rate is computed over the reset, and
+     * the next interval is from the reset sample
+     */
+    ir.update(1, "tap0", {"ep1"}, mk_sample(110, 100, 6400));
+    BOOST_CHECK_CLOSE(ir.last(1).get().rx_pps, 1000, 0.001);
+
+    ir.update(1, "tap0", {"ep1"}, mk_sample(115, 200, 12800));
+    BOOST_CHECK_CLOSE(ir.last(1).get().rx_pps, 20, 0.001);
+
+    ir.remove(1);
+    BOOST_CHECK(!ir.last(1));
+}
+
+BOOST_AUTO_TEST_CASE(drops)
+{
+    InterfaceRates ir;
+    InterfaceRates::sample_t s = mk_sample(100, 1000, 64000);
+    VOM::interface::stats_t stats = {};
+
+    /*
+     * a counter VPP does not keep reads as all ones, and is not a drop
+     */
+    stats.m_drop.packets = 10;
+    stats.m_rx_no_buf.packets = ~0ULL;
+    stats.m_tx_error.packets = 5;
+    s.drops = InterfaceRates::drops_t::from(stats);
+
+    BOOST_CHECK_EQUAL(s.drops.drop, 10);
+    BOOST_CHECK_EQUAL(s.drops.rx_miss, 0);
+    BOOST_CHECK_EQUAL(s.drops.rx_no_buf, 0);
+    BOOST_CHECK_EQUAL(s.drops.tx_error, 5);
+    BOOST_CHECK_EQUAL(s.drops.rx(), 10);
+    BOOST_CHECK_EQUAL(s.drops.tx(), 5);
+    ir.update(1, "tap0", {"ep1"}, s);
+
+    s = mk_sample(110, 2000, 128000);
+    s.drops = {60, 20, 20, 0, 5};
+    ir.update(1, "tap0", {"ep1"}, s);
+
+    BOOST_CHECK_CLOSE(ir.last(1).get().rx_drop_pps, 9, 0.001);
+    BOOST_CHECK_EQUAL(ir.last(1).get().tx_drop_pps, 0);
+}
+
+BOOST_AUTO_TEST_CASE(show)
+{
+    InterfaceRates ir;
+    std::ostringstream os;
+
+    ir.update(1, "tap0", {"ep1"}, mk_sample(100, 1000, 64000));
+    ir.update(1, "tap0", {"ep1"}, mk_sample(105, 6000, 384000));
+
+    /*
+     * the rates are shown to one decimal place, and the caller's
+     * formatting is left as it was
+     */
+    os.precision(3);
+    ir.show(os);
+    BOOST_CHECK(os.str().find("1000.0") != std::string::npos);
+    BOOST_CHECK(!(os.flags() & std::ios_base::fixed));
+    BOOST_CHECK_EQUAL(os.precision(), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */
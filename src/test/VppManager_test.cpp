@@ -52,6 +52,7 @@
 #include <vom/sub_interface.hpp>
 
 #include "VppManager.hpp"
+#include "VppSecurityGroupManager.hpp"
 #include "opflexagent/test/ModbFixture.h"
 #include <opflexagent/logging.h>
 
@@ -866,6 +867,25 @@ BOOST_FIXTURE_TEST_CASE(endpoint_group_add_del, VppStitchedManagerFixture)
                               {address::from_string("2001:db8::"), 32},
                               gbp_subnet::type_t::STITCHED_INTERNAL));
 
+    /*
+     * remove the new subnet; only it is withdrawn, the rest are kept
+     */
+    opflex::modb::Mutator m0(framework, policyOwner);
+    subnetsfd1_2->remove();
+    m0.commit();
+    vppManager.domainUpdated(modelgbp::gbp::RoutingDomain::CLASS_ID,
+                             rd0->getURI());
+
+    WAIT_FOR_NOT_PRESENT(gbp_subnet(v_rd,
+                                    {address::from_string("10.20.46.0"), 24},
+                                    gbp_subnet::type_t::STITCHED_INTERNAL));
+    WAIT_FOR_MATCH(gbp_subnet(v_rd,
+                              {address::from_string("10.20.44.0"), 24},
+                              gbp_subnet::type_t::STITCHED_INTERNAL));
+    WAIT_FOR_MATCH(gbp_subnet(v_rd,
+                              {address::from_string("2001:db8::"), 32},
+                              gbp_subnet::type_t::STITCHED_INTERNAL));
+
     /*
      * withdraw the route domain.
      */
@@ -1487,12 +1507,8 @@ BOOST_FIXTURE_TEST_CASE(secGroup, VppStitchedManagerFixture)
                        16);
     ACL::l3_list::rules_t rules({rule1, rule2, rule3, rule4});
 
-    boost::hash<std::string> string_hash;
-    const std::string secGrpKey =
-        std::to_string(string_hash("/PolicyUniverse/PolicySpace/"
-                                   "tenant0/GbpSecGroup/secgrp1/"));
-
-    WAIT_FOR1(is_match(ACL::l3_list(secGrpKey + "-out", rules)));
+    WAIT_FOR1(is_match(
+        ACL::l3_list(SecurityGroupManager::get_acl_name(rules), rules)));
 
     {
         opflex::modb::Mutator mutator(framework, policyOwner);
@@ -1545,12 +1561,8 @@ BOOST_FIXTURE_TEST_CASE(secGroup, VppStitchedManagerFixture)
                        0);
     ACL::l3_list::rules_t rules2({rule5});
 
-    const std::string secGrpKey2 = std::to_string(
-        string_hash("/PolicyUniverse/PolicySpace/"
-                    "tenant0/GbpSecGroup/secgrp1/,/PolicyUniverse/"
-                    "PolicySpace/tenant0/GbpSecGroup/secgrp2/"));
-
-    WAIT_FOR1(is_match(ACL::l3_list(secGrpKey2 + "-in", rules2)));
+    WAIT_FOR1(is_match(
+        ACL::l3_list(SecurityGroupManager::get_acl_name(rules2), rules2)));
 
     delete v_itf;
 }
@@ -1644,6 +1656,113 @@ BOOST_FIXTURE_TEST_CASE(policy, VppStitchedManagerFixture)
     WAIT_FOR1(is_match(gbp_contract(203, 187, outAcl2, grules2, allowed2)));
 }
 
+BOOST_FIXTURE_TEST_CASE(policyConsumerAddDel, VppStitchedManagerFixture)
+{
+    createObjects();
+    createPolicyObjects();
+    PolicyManager::uri_set_t egs;
+    WAIT_FOR_DO(egs.size() == 2, 1000, egs.clear();
+                policyMgr.getContractConsumers(con1->getURI(), egs));
+
+    vppManager.contractUpdated(con1->getURI());
+
+    ACL::action_t act = ACL::action_t::PERMIT;
+    ACL::l3_rule rule2(8192,
+                       act,
+                       route::prefix_t::ZERO,
+                       route::prefix_t::ZERO,
+                       6,
+                       0,
+                       65535,
+                       80,
+                       65535,
+                       0,
+                       0);
+    ACL::l3_rule rule3(7936,
+                       act,
+                       route::prefix_t::ZERO,
+                       route::prefix_t::ZERO,
+                       6,
+                       22,
+                       65535,
+                       0,
+                       65535,
+                       3,
+                       3);
+    ACL::l3_rule rule4(7808,
+                       act,
+                       route::prefix_t::ZERO,
+                       route::prefix_t::ZERO,
+                       6,
+                       21,
+                       65535,
+                       0,
+                       65535,
+                       16,
+                       16);
+    ACL::l3_list::rules_t rules2({rule2, rule3, rule4});
+
+    ACL::l3_list outAcl2(con1->getURI().toString() + "out", rules2);
+    WAIT_FOR_MATCH(outAcl2);
+
+    gbp_contract::gbp_rules_t grules2 = {{8192, gbp_rule::action_t::PERMIT},
+                                         {7936, gbp_rule::action_t::PERMIT},
+                                         {7808, gbp_rule::action_t::PERMIT}};
+    gbp_contract::ethertype_set_t allowed2 = {ethertype_t::IPV4,
+                                              ethertype_t::ARP};
+
+    gbp_contract c202_186(202, 186, outAcl2, grules2, allowed2);
+    gbp_contract c203_187(203, 187, outAcl2, grules2, allowed2);
+    gbp_contract c204_186(204, 186, outAcl2, grules2, allowed2);
+    gbp_contract c204_187(204, 187, outAcl2, grules2, allowed2);
+
+    WAIT_FOR1(is_match(c202_186));
+    WAIT_FOR1(is_match(c203_187));
+
+    /*
+     * a new consumer adds only its own pairs
+     */
+    std::shared_ptr<modelgbp::gbp::EpGroup> epg4;
+    std::shared_ptr<modelgbp::gbp::EpGroupToConsContractRSrc> cons;
+    {
+        opflex::modb::Mutator mutator(framework, policyOwner);
+        epg4 = space->addGbpEpGroup("epg4");
+        epg4->addGbpeInstContext()->setClassid(0xCC);
+        cons = epg4->addGbpEpGroupToConsContractRSrc(
+            con1->getURI().toString());
+        mutator.commit();
+    }
+    WAIT_FOR_DO(egs.size() == 3, 1000, egs.clear();
+                policyMgr.getContractConsumers(con1->getURI(), egs));
+
+    vppManager.contractUpdated(con1->getURI());
+
+    WAIT_FOR_MATCH(c204_186);
+    WAIT_FOR_MATCH(c204_187);
+    BOOST_CHECK(is_match(c202_186));
+    BOOST_CHECK(is_match(c203_187));
+    BOOST_CHECK(is_match(outAcl2));
+
+    /*
+     * and its removal removes only those
+     */
+    {
+        opflex::modb::Mutator mutator(framework, policyOwner);
+        cons->remove();
+        mutator.commit();
+    }
+    WAIT_FOR_DO(egs.size() == 2, 1000, egs.clear();
+                policyMgr.getContractConsumers(con1->getURI(), egs));
+
+    vppManager.contractUpdated(con1->getURI());
+
+    WAIT_FOR_NOT_PRESENT(c204_186);
+    WAIT_FOR_NOT_PRESENT(c204_187);
+    BOOST_CHECK(is_match(c202_186));
+    BOOST_CHECK(is_match(c203_187));
+    BOOST_CHECK(is_match(outAcl2));
+}
+
 BOOST_FIXTURE_TEST_CASE(policyPortRange, VppStitchedManagerFixture)
 {
     createObjects();
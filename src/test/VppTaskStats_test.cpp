@@ -0,0 +1,121 @@
+/*
+ * Test suite for VppTaskStats
+ *
+ * Copyright (c) 2018 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <sstream>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+#include "VppTaskStats.hpp"
+
+using namespace VPP;
+
+BOOST_AUTO_TEST_SUITE(VppTaskStats_test)
+
+BOOST_AUTO_TEST_CASE(histogram)
+{
+    Histogram h;
+
+    BOOST_CHECK_EQUAL(h.count(), 0);
+    BOOST_CHECK_EQUAL(h.mean(), 0);
+    BOOST_CHECK_EQUAL(h.percentile(50), 0);
+
+    for (uint64_t v = 1; v <= 100; v++)
+        h.record(v);
+
+    BOOST_CHECK_EQUAL(h.count(), 100);
+    BOOST_CHECK_EQUAL(h.mean(), 50);
+    BOOST_CHECK_EQUAL(h.max(), 100);
+
+    /*
+     * small values are exact, the others are within an eighth
+     */
+    BOOST_CHECK_EQUAL(h.percentile(5), 5);
+    BOOST_CHECK_LE(h.percentile(50), 50);
+    BOOST_CHECK_GE(h.percentile(50), 50 - 50 / 8);
+    BOOST_CHECK_LE(h.percentile(99), 99);
+    BOOST_CHECK_GE(h.percentile(99), 99 - 99 / 8);
+    BOOST_CHECK_LE(h.percentile(100), 100);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_precision)
+{
+    /*
+     * each value, alone, is reported to within an eighth, below it
+     */
+    for (uint64_t v = 1; v < (1ULL << 40); v = v * 3 + 1)
+    {
+        Histogram h;
+
+        h.record(v);
+        BOOST_CHECK_LE(h.percentile(100), v);
+        BOOST_CHECK_GE(h.percentile(100), v - v / 8);
+    }
+
+    /*
+     * values beyond the buckets are counted in the last, and reported
+     * no larger than the largest recorded
+     */
+    Histogram h;
+
+    h.record(1ULL << 50);
+    BOOST_CHECK_EQUAL(h.count(), 1);
+    BOOST_CHECK_EQUAL(h.max(), 1ULL << 50);
+    BOOST_CHECK_LE(h.percentile(100), 1ULL << 50);
+}
+
+/**
+ * The largest number of commands a task of the given type sent, as
+ * shown by inspect
+ */
+static uint64_t
+max_cmds(const std::string &type)
+{
+    std::ostringstream os;
+
+    TaskStats::get().show(os);
+
+    std::istringstream is(os.str());
+    std::string line;
+    bool in_type = false;
+
+    while (std::getline(is, line))
+    {
+        if (line.compare(0, type.size() + 1, type + " ") == 0)
+            in_type = true;
+        else if (in_type && line.find("cmds") != std::string::npos)
+            return std::stoull(line.substr(line.find("max:") + 4));
+    }
+    return ~0ULL;
+}
+
+BOOST_AUTO_TEST_CASE(per_thread_cmds)
+{
+    /*
+     * the commands sent by another thread while the task runs are not
+     * the task's
+     */
+    TaskStats::get().run(
+        "test-cmds", std::chrono::steady_clock::now(), []() {
+            TaskStats::get().issued(2);
+            std::thread t([]() { TaskStats::get().issued(5); });
+            t.join();
+        });
+
+    BOOST_CHECK_EQUAL(max_cmds("test-cmds"), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/*
+ * Local Variables:
+ * eval: (c-set-style "llvm.org")
+ * End:
+ */